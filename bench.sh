@@ -0,0 +1,130 @@
+#!/bin/bash
+# Licence d'Informatique - UE SR2
+# Université Toulouse III - Paul Sabatier / FSI / DDI
+
+# --------------------------------------------------------------
+# BENCHMARK: débit et temps CPU par Go transféré, pour chaque
+# variante (paramètres de config.txt) et taille de charge utile,
+# en boucle locale. A lancer après "make tdd5".
+#
+# Usage : ./bench.sh [taille_mo [fenetre [nb_essais [variante...]]]]
+#   (toutes les variantes par défaut)
+# --------------------------------------------------------------
+
+TAILLE_MO=${1:-200}
+FENETRE=${2:-8}
+ESSAIS=${3:-3}
+shift 3 2> /dev/null
+TAILLES_INFO="1400 65495"
+
+# nom de la variante et ses paramètres (séparés par ';') ; FLUX n
+# n'est pas un paramètre de config.txt : transfert en n flux parallèles
+declare -A VARIANTES=(
+    [socket]="BACKEND_RESEAU socket"
+    [io_uring]="BACKEND_RESEAU io_uring"
+    [pipeline]="PIPELINE_APPLI 1"
+    [disque_lent]="LATENCE_DISQUE_MS 2"
+    [disque_lent_pipeline]="LATENCE_DISQUE_MS 2;PIPELINE_APPLI 1"
+    [flux_1]="FLUX 1"
+    [flux_2]="FLUX 2"
+    [flux_4]="FLUX 4"
+    [flux_4_disque_lent]="FLUX 4;LATENCE_DISQUE_MS 2"
+    [flux_4_rythme]="FLUX 4;RYTHME_EMISSION auto"
+)
+ORDRE="socket io_uring pipeline disque_lent disque_lent_pipeline flux_1 flux_2 flux_4"
+[[ $# -gt 0 ]] && ORDRE="$*"
+
+TMP=`mktemp -d`
+IN=$TMP/in.bin
+OUT=$TMP/out.bin
+CONFIG=config.txt
+
+function cleanup {
+
+    pkill -x emetteur
+    pkill -x recepteur
+    rm -rf $TMP
+    cp ./tests/c01-txt-no-error.txt ./$CONFIG
+}
+trap cleanup EXIT
+
+# $1 variante; $2 taille de charge utile
+function write_config {
+
+    cat > $CONFIG <<EOF
+FICHIER_IN $IN
+FICHIER_OUT $OUT
+TAILLE_INFO $2
+NIVEAU_TRACE 1
+EOF
+    echo "${VARIANTES[$1]}" | tr ';' '\n' | grep -v '^FLUX ' >> $CONFIG
+    NB_FLUX=`echo "${VARIANTES[$1]}" | tr ';' '\n' | awk '$1 == "FLUX" { print $2 }'`
+    NB_FLUX=${NB_FLUX:-1}
+}
+
+# Temps CPU (user + sys, en ms) des processus fils du shell courant,
+# d'après la deuxième ligne du builtin times ("0m1.234s 0m0.567s"),
+# qui doit s'exécuter dans ce shell (pas dans un tube). Résultat dans $1.
+function children_cpu_ms {
+
+    times > $1
+    tail -1 $1 | tr 'ms' '  ' | \
+        awk '{ printf "%d", ($1 * 60 + $2 + $3 * 60 + $4) * 1000 }' > $1.ms
+    mv $1.ms $1
+}
+
+# Un transfert : affiche "durée_ms cpu_emetteur_ms cpu_recepteur_ms"
+function run_once {
+
+    rm -f $OUT
+    ( ./bin/recepteur $FENETRE 1 $NB_FLUX > /dev/null 2>&1; children_cpu_ms $TMP/cpu_r ) &
+    pidR=$!
+    sleep 0.5
+    debut=`date +%s%N`
+    ( ./bin/emetteur $FENETRE "" "" $NB_FLUX > /dev/null 2>&1; children_cpu_ms $TMP/cpu_e )
+    fin=`date +%s%N`
+    wait $pidR
+    if ! cmp -s $IN $OUT; then
+        echo "ERREUR"
+        return
+    fi
+    echo $(( (fin - debut) / 1000000 )) `cat $TMP/cpu_e` `cat $TMP/cpu_r`
+}
+
+if [[ ! -x ./bin/emetteur || ! -x ./bin/recepteur ]]; then
+    echo "Executables absents : lancer make tdd5 avant."
+    exit 1
+fi
+
+head -c $(( TAILLE_MO * 1024 * 1024 )) /dev/urandom > $IN
+
+echo "Transfert de $TAILLE_MO Mo, fenetre $FENETRE, meilleur de $ESSAIS essais"
+printf "%-21s %6s %9s %10s %10s %10s\n" variante info "duree_ms" "debit_Mo/s" \
+       "emet_s/Go" "recep_s/Go"
+for info in $TAILLES_INFO; do
+    for variante in $ORDRE; do
+        if [[ -z ${VARIANTES[$variante]} ]]; then
+            echo "Variante inconnue : $variante"
+            exit 1
+        fi
+        write_config $variante $info
+        meilleur=""
+        for i in `seq 1 $ESSAIS`; do
+            res=`run_once`
+            [[ $res == ERREUR ]] && { meilleur=$res; break; }
+            # meilleur essai : CPU total le plus faible
+            if [[ -z $meilleur ]] || (( `echo $res | awk '{ print $2 + $3 }'` < \
+                                        `echo $meilleur | awk '{ print $2 + $3 }'` )); then
+                meilleur=$res
+            fi
+        done
+        if [[ $meilleur == ERREUR ]]; then
+            printf "%-21s %6s %s\n" $variante $info "fichiers differents"
+            continue
+        fi
+        echo $meilleur | awk -v v=$variante -v i=$info -v mo=$TAILLE_MO '{
+            go = mo / 1024
+            printf "%-21s %6s %9d %10.1f %10.2f %10.2f\n", v, i, $1, mo * 1000 / $1,
+                   $2 / 1000 / go, $3 / 1000 / go }'
+    done
+done
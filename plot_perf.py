@@ -1,37 +1,107 @@
+import argparse
 import csv
 import matplotlib.pyplot as plt
 import numpy as np
+from matplotlib.animation import FuncAnimation
+
+# perf.txt is written by the sender as the transfer goes (one line per
+# PERIODE_CALCUL_DEBIT): "--live" follows the file while it grows
+parser = argparse.ArgumentParser(description='Plot the sender performance trace')
+parser.add_argument('filename', nargs='?', default='perf.txt')
+parser.add_argument('--live', action='store_true', help='follow the file while it is written')
+args = parser.parse_args()
 
-# Load the CSV file
-filename = "perf.txt"
 time = []
 packets_sent = []
 packets_droped = []
+bytes_sent = []
+retransmits = []
+rtt = []
+window = []
+cwnd = []
+
+file = open(args.filename, mode='r')
+file.readline()  # Skip the header row
+partial = ''
+
 
-with open(filename, mode='r') as file:
-    reader = csv.reader(file, delimiter=';')
-    next(reader)  # Skip the header row
-    for row in reader:
-        time.append(int(row[0]))
+# Read the complete lines appended since the last call
+def read_new_rows():
+    global partial
+    data = partial + file.read()
+    lines = data.split('\n')
+    partial = lines.pop()  # last line may still be being written
+    for row in csv.reader(lines, delimiter=';'):
+        if not row:
+            continue
+        time.append(float(row[0]))
         packets_sent.append(int(row[1]))
         packets_droped.append(int(row[2]))
+        bytes_sent.append(int(row[3]))
+        retransmits.append(int(row[4]))
+        rtt.append(int(row[5]) / 1000)  # us -> ms
+        window.append(int(row[6]))
+        cwnd.append(float(row[7]) if len(row) > 7 else 0.0)  # 0: no congestion control
+
+
+# Throughput in kB/s over each sampling period (real sampling dates):
+# follows the payload size (TAILLE_INFO) used for the run
+def throughput():
+    periods = np.diff([0.0] + time)
+    return [b / p if p > 0 else 0 for b, p in zip(bytes_sent, periods)]  # bytes/ms == kB/s
+
 
-period = time[1] - time[0]
+# Create the plot: throughput with drops and retransmissions, then RTT
+# with the number of packets in flight and the congestion window
+fig, (ax, ax_rtt) = plt.subplots(2, 1, sharex=True)
 
-# Create the plot
-fig, ax = plt.subplots()
+ax.set_ylabel('Throughput (kB/s)')
+line_throughput, = ax.plot([], [], color='tab:blue', label='Throughtput')
+line_avg = ax.axhline(y=0, color='tab:blue', linestyle='--', label='Avg Throughput')
+ax.legend(loc='upper left')
 
-# Set axis labels
-ax.set_xlabel('Time (ms)')
-ax.set_ylabel('Packets / ' + str(period) + ' ms')
-# Plot packets sent and droped on the y-axis
-ax.plot(time, packets_sent, color='tab:blue', label='Throughtput')
-ax.axhline(y=np.nanmean(packets_sent), color='tab:blue', linestyle='--', label='Avg Throughput')
-ax.plot(time, packets_droped, color='tab:red', label='Drops')
-ax.legend()
+ax_drops = ax.twinx()
+ax_drops.set_ylabel('Packets / period')
+line_drops, = ax_drops.plot([], [], color='tab:red', label='Drops')
+line_retransmits, = ax_drops.plot([], [], color='tab:orange', label='Retransmits')
+ax_drops.legend(loc='upper right')
+
+ax_rtt.set_xlabel('Time (ms)')
+ax_rtt.set_ylabel('RTT (ms)')
+line_rtt, = ax_rtt.plot([], [], color='tab:green', label='Mean RTT')
+ax_rtt.legend(loc='upper left')
+
+ax_window = ax_rtt.twinx()
+ax_window.set_ylabel('Packets (in flight / cwnd)')
+line_window, = ax_window.step([], [], color='tab:purple', where='post', label='Window')
+line_cwnd, = ax_window.plot([], [], color='tab:brown', linestyle='--', label='Cwnd')
+ax_window.legend(loc='upper right')
 
 # Add a title
-plt.title('Throughput and packet loss over time')
+ax.set_title('Throughput and packet loss over time')
+
+
+def update(frame):
+    read_new_rows()
+    if not time:
+        return
+    tp = throughput()
+    line_throughput.set_data(time, tp)
+    line_avg.set_ydata([np.nanmean(tp)] * 2)
+    line_drops.set_data(time, packets_droped)
+    line_retransmits.set_data(time, retransmits)
+    line_rtt.set_data(time, rtt)
+    line_window.set_data(time, window)
+    line_cwnd.set_data(time, cwnd)
+    for a in (ax, ax_drops, ax_rtt, ax_window):
+        a.relim()
+        a.autoscale_view()
+
+
+fig.tight_layout()
+update(0)
+if args.live:
+    animation = FuncAnimation(fig, update, interval=500, cache_frame_data=False)
 
 # Show the plot
 plt.show()
@@ -98,6 +98,71 @@ function run_test {
     fi
 }
 
+# $1 test number; $2 test name; then the files sent at the same time,
+# one sender each, to a single receiver (connected mode, multi-flow)
+function run_test_multi {
+
+    printf "\n*** Running test $1 ($2) ***\n"
+    num=$1; name=$2; shift 2
+
+    DIR=`dirname $(grep ^FICHIER_OUT $CONFIG | cut -d ' ' -f 2)`
+    echo "--> Running receiver..."
+    timeout $TIMEOUT ./bin/recepteur 8 $# > $LOG/${num}_rec_log.txt 2>&1 &
+    pidR=$!
+    sleep 1
+    echo "--> Running senders..."
+    pids=""
+    for f in "$@"; do
+        b=`basename $f`
+        timeout $TIMEOUT ./bin/emetteur 8 $f recu_$b > $LOG/${num}_sen_${b}_log.txt 2>&1 &
+        pids="$pids $!"
+    done
+    wait $pids $pidR 2> /dev/null
+
+    ok=1
+    for f in "$@"; do
+        b=`basename $f`
+        diff $f $DIR/recu_$b > /dev/null || ok=0
+        rm -f $DIR/recu_$b # clean output file
+    done
+    if [[ $ok -eq 1 ]]; then
+        printf "%s %s [${GREEN}OK${NC}]\n" $num $name
+        return 1
+    else
+        printf "%s %s [${RED}Different files${NC}]\n" $num $name
+        return 0
+    fi
+}
+
+# $1 test number; $2 test name; $3 number of flows: FICHIER_IN is sent
+# in $3 stripes, one sender and one receiver process per flow
+function run_test_striped {
+
+    printf "\n*** Running test $1 ($2) ***\n"
+
+    F1=`cat $CONFIG | grep FICHIER_IN | cut -d ' ' -f 2`
+    F2=`cat $CONFIG | grep FICHIER_OUT | cut -d ' ' -f 2`
+    echo "--> Running receiver..."
+    timeout $TIMEOUT ./bin/recepteur 8 1 $3 > $LOG/$1_rec_log.txt 2>&1 &
+    pidR=$!
+    sleep 1
+    echo "--> Running sender..."
+    timeout $TIMEOUT ./bin/emetteur 8 "" "" $3 > $LOG/$1_sen_log.txt 2>&1 &
+    pidE=$!
+    wait $pidE $pidR 2> /dev/null
+
+    diff $F1 $F2 > /dev/null
+    if [[ $? -eq 0 ]]; then
+        printf "%s %s [${GREEN}OK${NC}]\n" $1 $2
+        rm $F2 # clean output file
+        return 1
+    else
+        printf "%s %s [${RED}Different files${NC}]\n" $1 $2
+        rm -f $F2 # clean output file
+        return 0
+    fi
+}
+
 # =============================================================================
 
 function run_tests_1 {
@@ -112,6 +177,9 @@ function run_tests_1 {
     # JPG sans erreur/perte
     cp $TEST/c02-jpg-no-error.txt ./config.txt
     run_test 1.2 JPG-NO-ERROR-NO-LOSS
+    # TXT de taille multiple de TAILLE_INFO (fin signalée par un message vide)
+    cp $TEST/c13-txt-exact-multiple.txt ./config.txt
+    run_test 1.3 TXT-EXACT-MULTIPLE
 }
 
 function run_tests_2 {
@@ -123,6 +191,9 @@ function run_tests_2 {
     # TXT erreurs sur les données
     cp $TEST/c03-txt-error-data.txt ./config.txt
     run_test 2.1 TXT-ERROR-DATA
+    # TXT erreurs de plusieurs bits sur les données
+    cp $TEST/c12-txt-multibit-error-data.txt ./config.txt
+    run_test 2.2 TXT-MULTIBIT-ERROR-DATA
 }
 
 function run_tests_3 {
@@ -165,6 +236,55 @@ function run_tests_5 {
     # JPG erreurs et pertes sur tous les paquets
     cp $TEST/c09-jpg-error-loss-all.txt ./config.txt
     run_test 5.1 JPG-ERROR-LOSS-ALL
+    # idem, couche réseau io_uring
+    cp $TEST/c16-jpg-io-uring-error-loss-all.txt ./config.txt
+    run_test 5.2 JPG-IO-URING-ERROR-LOSS-ALL
+    # idem, fichiers lus / écrits par un thread séparé, stockage lent
+    cp $TEST/c17-jpg-pipeline-slow-disk.txt ./config.txt
+    run_test 5.3 JPG-PIPELINE-SLOW-DISK
+    # idem, acquittements différés (un pour 2 paquets)
+    cp $TEST/c19-jpg-delayed-ack-error-loss.txt ./config.txt
+    run_test 5.4 JPG-DELAYED-ACK-ERROR-LOSS
+    # idem, contrôle de congestion CUBIC de l'émetteur
+    cp $TEST/c20-jpg-congestion-error-loss.txt ./config.txt
+    run_test 5.5 JPG-CONGESTION-ERROR-LOSS
+    # idem, émission rythmée à 20 Mbit/s
+    cp $TEST/c21-jpg-pacing-error-loss.txt ./config.txt
+    run_test 5.6 JPG-PACING-ERROR-LOSS
+}
+
+function run_tests_6 {
+
+    echo ""
+    echo "*******************************************************"
+    echo -e "**** ${BLUE}Tests charge utile jumbo (TAILLE_INFO)${NC} ****"
+    echo "*******************************************************"
+    # JPG paquets de 1400 octets, erreurs et pertes sur tous les paquets
+    cp $TEST/c10-jpg-jumbo-error-loss-all.txt ./config.txt
+    run_test 6.1 JPG-JUMBO-ERROR-LOSS-ALL
+    # JPG paquets de 64 Ko en boucle locale
+    cp $TEST/c11-jpg-jumbo-loopback.txt ./config.txt
+    run_test 6.2 JPG-JUMBO-LOOPBACK
+}
+
+function run_tests_7 {
+
+    echo ""
+    echo "***************************************************"
+    echo -e "**** ${BLUE}Tests mode connecte (ouverture/fermeture)${NC} ****"
+    echo "***************************************************"
+    # TXT pertes des paquets de connexion, erreurs et pertes sur les données
+    cp $TEST/c14-txt-loss-connection.txt ./config.txt
+    run_test 7.1 TXT-LOSS-CONNECTION
+    # 3 émetteurs simultanés vers un seul récepteur, erreurs et pertes
+    cp $TEST/c15-multi-flow-error-loss.txt ./config.txt
+    run_test_multi 7.2 MULTI-FLOW-ERROR-LOSS fichiers/in.txt fichiers/palmier.jpg fichiers/lion.jpg
+    # 1 fichier découpé en 4 tronçons émis en parallèle, erreurs et pertes
+    cp $TEST/c18-jpg-striped-error-loss.txt ./config.txt
+    run_test_striped 7.3 JPG-STRIPED-ERROR-LOSS 4
+    # idem, tronçons lus par un thread séparé
+    cp $TEST/c22-jpg-striped-pipeline.txt ./config.txt
+    run_test_striped 7.4 JPG-STRIPED-PIPELINE 4
 }
 
 # =============================================================================
@@ -188,8 +308,10 @@ error_data="Erreurs sur les paquets de données"
 error_loss_data="Erreurs et Pertes sur les paquets de données"
 error_loss_ack="Erreurs et Pertes sur les paquets d'acquittements"
 error_loss_all="Erreurs et Pertes sur tous les paquets"
+jumbo="Charge utile jumbo"
+connected="Mode connecté"
 
-options=("$no_error_no_loss" "$error_data" "$error_loss_data" "$error_loss_ack" "$error_loss_all" "CHAOS! Run all!")
+options=("$no_error_no_loss" "$error_data" "$error_loss_data" "$error_loss_ack" "$error_loss_all" "$jumbo" "$connected" "CHAOS! Run all!")
 
 echo ">>> TESTS TP RESEAUX SR2 <<<"
 echo "Choisir les tests que vous voulez exécuter :"
@@ -203,7 +325,9 @@ do
     3) run_tests_3 ; break ;;
     4) run_tests_4 ; break ;;
     5) run_tests_5 ; break ;;
-    6) run_tests_1; run_tests_2; run_tests_3; run_tests_4; run_tests_5 ; break ;;
+    6) run_tests_6 ; break ;;
+    7) run_tests_7 ; break ;;
+    8) run_tests_1; run_tests_2; run_tests_3; run_tests_4; run_tests_5; run_tests_6; run_tests_7 ; break ;;
     *) echo "Option invalide" ;;
     esac
 done
@@ -0,0 +1,96 @@
+/*************************************************************
+* Anneau de blocs entre deux threads (un producteur, un      *
+* consommateur), sans verrou                                 *
+*                                                            *
+* publies - liberes = nombre de blocs pleins. Le thread qui  *
+* va dormir lève son drapeau d'attente puis relit le         *
+* compteur de l'autre ; l'autre écrit son compteur puis lit  *
+* ce drapeau (ordre séquentiel) : l'un des deux voit         *
+* toujours l'écriture de l'autre, aucun réveil n'est perdu.  *
+**************************************************************/
+
+#define _GNU_SOURCE /* syscall */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "anneau.h"
+
+/* tours d'attente active avant de dormir : l'autre thread est
+ * souvent sur le point de publier (ou de libérer) un bloc */
+#define TOURS_ACTIFS 200
+
+int anneau_init(anneau_t *anneau, unsigned nb_blocs, size_t taille_bloc)
+{
+    /* blocs alignés sur une ligne de cache */
+    taille_bloc = (taille_bloc + 63) & ~(size_t)63;
+    if (posix_memalign((void **)&anneau->blocs, 64, nb_blocs * taille_bloc) != 0)
+        return -1;
+    anneau->taille_bloc = taille_bloc;
+    anneau->nb_blocs = nb_blocs;
+    atomic_init(&anneau->publies, 0);
+    atomic_init(&anneau->liberes, 0);
+    atomic_init(&anneau->attente_conso, 0);
+    atomic_init(&anneau->attente_prod, 0);
+    return 0;
+}
+
+void anneau_detruire(anneau_t *anneau)
+{
+    free(anneau->blocs);
+    anneau->blocs = NULL;
+}
+
+/* Attente de la modification de *compteur (égal à valeur) par l'autre thread */
+static void attendre_modification(atomic_uint *compteur, unsigned valeur, atomic_int *attente)
+{
+    for (int i = 0; i < TOURS_ACTIFS; i++) {
+        if (atomic_load_explicit(compteur, memory_order_acquire) != valeur)
+            return;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    atomic_store(attente, 1);
+    while (atomic_load(compteur) == valeur)
+        syscall(SYS_futex, compteur, FUTEX_WAIT_PRIVATE, valeur, NULL, NULL, 0);
+    atomic_store(attente, 0);
+}
+
+/* Réveil de l'autre thread s'il attend la modification de *compteur */
+static void reveiller(atomic_uint *compteur, atomic_int *attente)
+{
+    if (atomic_load(attente))
+        syscall(SYS_futex, compteur, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void *anneau_produire(anneau_t *anneau)
+{
+    unsigned p = atomic_load_explicit(&anneau->publies, memory_order_relaxed);
+
+    while (p - atomic_load_explicit(&anneau->liberes, memory_order_acquire) == anneau->nb_blocs)
+        attendre_modification(&anneau->liberes, p - anneau->nb_blocs, &anneau->attente_prod);
+    return anneau->blocs + (p & (anneau->nb_blocs - 1)) * anneau->taille_bloc;
+}
+
+void anneau_publier(anneau_t *anneau)
+{
+    atomic_fetch_add(&anneau->publies, 1);
+    reveiller(&anneau->publies, &anneau->attente_conso);
+}
+
+void *anneau_consommer(anneau_t *anneau)
+{
+    unsigned l = atomic_load_explicit(&anneau->liberes, memory_order_relaxed);
+
+    while (atomic_load_explicit(&anneau->publies, memory_order_acquire) == l)
+        attendre_modification(&anneau->publies, l, &anneau->attente_conso);
+    return anneau->blocs + (l & (anneau->nb_blocs - 1)) * anneau->taille_bloc;
+}
+
+void anneau_liberer(anneau_t *anneau)
+{
+    atomic_fetch_add(&anneau->liberes, 1);
+    reveiller(&anneau->liberes, &anneau->attente_prod);
+}
@@ -0,0 +1,45 @@
+/*************************************************************
+* Anneau de blocs entre deux threads (un producteur, un      *
+* consommateur), sans verrou                                 *
+*                                                            *
+* Le producteur remplit un bloc libre puis le publie, le     *
+* consommateur le traite puis le libère. Chaque compteur     *
+* n'est modifié que par un seul des deux threads ; celui qui *
+* trouve l'anneau plein (ou vide) attend sur un futex, et    *
+* n'est réveillé que s'il s'est déclaré en attente.          *
+**************************************************************/
+
+#ifndef __ANNEAU_H__
+#define __ANNEAU_H__
+
+#include <stddef.h> /* size_t */
+#include <stdatomic.h>
+
+typedef struct anneau_s {
+    unsigned char *blocs;
+    size_t taille_bloc;
+    unsigned nb_blocs;         /* puissance de 2 */
+    /* une ligne de cache par thread */
+    _Alignas(64) atomic_uint publies;   /* blocs publiés (producteur) */
+    atomic_int attente_conso;           /* consommateur endormi */
+    _Alignas(64) atomic_uint liberes;   /* blocs libérés (consommateur) */
+    atomic_int attente_prod;            /* producteur endormi */
+} anneau_t;
+
+/* Allocation de nb_blocs (puissance de 2) blocs de taille_bloc octets.
+ * Renvoie 0, ou -1 si la mémoire manque. */
+int anneau_init(anneau_t *anneau, unsigned nb_blocs, size_t taille_bloc);
+
+void anneau_detruire(anneau_t *anneau);
+
+/* Producteur : prochain bloc à remplir (attend qu'un bloc soit libre),
+ * puis publication de ce bloc au consommateur */
+void *anneau_produire(anneau_t *anneau);
+void anneau_publier(anneau_t *anneau);
+
+/* Consommateur : prochain bloc publié (attend qu'il y en ait un),
+ * puis libération de ce bloc une fois traité */
+void *anneau_consommer(anneau_t *anneau);
+void anneau_liberer(anneau_t *anneau);
+
+#endif
@@ -8,52 +8,513 @@
 * E. Lavinal - Univ. de Toulouse III - Paul Sabatier       *
 ************************************************************/
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h> /* intptr_t */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "anneau.h"
 #include "application.h"
 #include "config.h"
+#include "couche_transport.h" /* LG_NOM_MAX */
+#include "trace.h"
 
-static FILE *fichier = NULL;
+/* taille du tampon d'écriture du récepteur */
+#define TAMPON_ECRITURE (4 * 1024 * 1024)
+/* taille du tampon d'un fichier parmi plusieurs reçus en même temps */
+#define TAMPON_FLUX (1024 * 1024)
+
+/* mode pipeline (PIPELINE_APPLI) : le fichier est lu (émetteur) ou
+ * écrit (récepteur) par un thread d'E/S, qui échange avec le thread de
+ * transport des blocs de données par un anneau sans verrou ; une
+ * lecture ou une écriture lente ne retarde plus le traitement des
+ * paquets tant que l'anneau n'est pas vide (ou plein) */
+#define NB_BLOCS 16              /* blocs de l'anneau (puissance de 2) */
+#define BLOC_LECTURE (256 * 1024) /* taille d'un bloc lu par le thread */
+/* unité de la latence de stockage simulée (LATENCE_DISQUE_MS) */
+#define BLOC_DISQUE (256 * 1024)
+
+typedef struct bloc_s {
+    size_t taille; /* octets de données (0 : fin du fichier) */
+    unsigned char donnees[];
+} bloc_t;
+
+static int pipeline = -1; /* PIPELINE_APPLI, lu à la première ouverture */
+static int latence_ms = 0; /* LATENCE_DISQUE_MS */
+
+static int lecture_max = 0; /* taille des blocs lus (TAILLE_INFO) */
+
+/* émetteur : fichier projeté en mémoire, lu par blocs de lecture_max */
+static const unsigned char *projection = NULL;
+static size_t taille_fichier = 0; /* octets à émettre (tronçon) */
+static size_t position = 0;
+/* tronçon à émettre (tout le fichier par défaut) */
+static uint64_t debut_troncon = 0;
+static uint64_t taille_troncon = UINT64_MAX;
+/* projection complète, alignée sur une page (munmap) */
+static void *debut_projection = NULL;
+static size_t taille_projection = 0;
+static size_t prochaine_latence = 0; /* position de la prochaine latence simulée */
+static int fichier_ouvert = 0; /* 0 pas encore, 1 ouvert, 2 terminé */
+static const char *fichier_choisi = NULL; /* NULL : FICHIER_IN */
+
+/* émetteur en mode pipeline : blocs lus par le thread lecteur */
+static anneau_t anneau_lecture;
+static pthread_t lecteur;
+static bloc_t *bloc_lu = NULL; /* bloc en cours d'émission */
+static size_t position_bloc = 0;
+
+/* récepteur : écritures regroupées dans un tampon, ou (mode pipeline)
+ * dans les blocs de l'anneau vidé par le thread écrivain du fichier */
+struct fichier_recu_s {
+    int fd;
+    off_t position; /* prochaine écriture (pwrite) */
+    unsigned char *tampon;
+    size_t capacite;
+    size_t rempli;
+    anneau_t anneau;
+    pthread_t ecrivain;
+    bloc_t *bloc; /* bloc en cours de remplissage */
+    size_t capacite_bloc;
+};
+
+/*
+* Lecture de la configuration du mode pipeline (une seule fois).
+*/
+static void lire_conf_pipeline()
+{
+    if (pipeline < 0) {
+        pipeline = conf_app_pipeline();
+        latence_ms = conf_disk_latency_ms();
+    }
+}
+
+/*
+* Latence de stockage simulée pour octets lus ou écrits.
+*/
+static void latence_disque(size_t octets)
+{
+    if (latence_ms > 0 && octets > 0)
+        usleep((long long)latence_ms * 1000 * octets / BLOC_DISQUE);
+}
+
+/*
+* Thread lecteur (mode pipeline) : le fichier est lu par blocs entiers de
+* messages, publiés dans l'anneau ; un bloc vide signale la fin du fichier.
+*/
+static void *lire_fichier(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    size_t capacite = anneau_lecture.taille_bloc - sizeof(bloc_t);
+    size_t reste = taille_fichier; /* octets du tronçon restant à lire */
+    bloc_t *bloc;
+
+    /* des messages entiers par bloc : un message n'est jamais à cheval */
+    capacite -= capacite % lecture_max;
+    do {
+        size_t a_lire = reste < capacite ? reste : capacite;
+        bloc = anneau_produire(&anneau_lecture);
+        bloc->taille = 0;
+        while (bloc->taille < a_lire) {
+            ssize_t n = read(fd, bloc->donnees + bloc->taille, a_lire - bloc->taille);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0) {
+                perror("[APP] Problème lecture fichier !\n");
+                exit(1);
+            }
+            if (n == 0)
+                break;
+            bloc->taille += n;
+        }
+        reste -= bloc->taille;
+        latence_disque(bloc->taille);
+        anneau_publier(&anneau_lecture);
+    } while (bloc->taille > 0);
+    close(fd);
+    return NULL;
+}
+
+static fichier_recu_t *sortie = NULL; /* fichier de vers_application() */
+
+/*
+* Ouverture et projection en mémoire du fichier à émettre.
+*/
+static void ouvrir_fichier_emission()
+{
+    char nom_fichier[MAX_FILE_NAME];
+    struct stat st;
+    int fd;
+
+    if (fichier_choisi != NULL)
+        snprintf(nom_fichier, sizeof(nom_fichier), "%s", fichier_choisi);
+    else
+        conf_app_sender(nom_fichier);
+    fd = open(nom_fichier, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror("[APP] Problème ouverture fichier en lecture !\n");
+        exit(1);
+    }
+    lecture_max = conf_info_size();
+    lire_conf_pipeline();
+    fichier_ouvert = 1;
+    /* tronçon [debut_troncon, fin[ du fichier */
+    if (debut_troncon > (uint64_t)st.st_size)
+        debut_troncon = st.st_size;
+    if (taille_troncon > (uint64_t)st.st_size - debut_troncon)
+        taille_troncon = st.st_size - debut_troncon;
+    taille_fichier = taille_troncon;
+    if (pipeline) {
+        /* blocs de BLOC_LECTURE octets au moins, et d'un message au moins */
+        size_t taille_bloc = sizeof(bloc_t) +
+            (lecture_max > BLOC_LECTURE ? lecture_max : BLOC_LECTURE);
+        /* positionnement sur le tronçon avant que le thread lecteur ne
+         * commence à lire */
+        if (lseek(fd, debut_troncon, SEEK_SET) < 0) {
+            perror("[APP] Problème positionnement dans le fichier !\n");
+            exit(1);
+        }
+        if (anneau_init(&anneau_lecture, NB_BLOCS, taille_bloc) < 0 ||
+            pthread_create(&lecteur, NULL, lire_fichier, (void *)(intptr_t)fd) != 0) {
+            perror("[APP] Problème création du thread lecteur !\n");
+            exit(1);
+        }
+        return;
+    }
+    if (taille_fichier > 0) {
+        /* projection depuis la page qui contient le début du tronçon */
+        off_t page = debut_troncon - debut_troncon % sysconf(_SC_PAGESIZE);
+        taille_projection = debut_troncon + taille_fichier - page;
+        debut_projection = mmap(NULL, taille_projection, PROT_READ, MAP_PRIVATE, fd, page);
+        if (debut_projection == MAP_FAILED) {
+            perror("[APP] Problème projection du fichier en mémoire !\n");
+            exit(1);
+        }
+        madvise(debut_projection, taille_projection, MADV_SEQUENTIAL);
+        projection = (const unsigned char *)debut_projection + (debut_troncon - page);
+    }
+    /* la projection reste valide après la fermeture du descripteur */
+    close(fd);
+}
+
+/*
+* Prochain message du fichier projeté (taille_msg == 0 en fin de fichier).
+*/
+static const unsigned char *lire_projection(int *taille_msg)
+{
+    const unsigned char *donnees = projection + position;
+    size_t reste = taille_fichier - position;
+
+    *taille_msg = reste < (size_t)lecture_max ? (int)reste : lecture_max;
+    if (position + *taille_msg > prochaine_latence) {
+        /* premier accès à ce bloc du fichier */
+        latence_disque(BLOC_DISQUE);
+        prochaine_latence += BLOC_DISQUE;
+    }
+    position += *taille_msg;
+    return donnees;
+}
+
+/*
+* Prochain message du bloc lu par le thread lecteur (mode pipeline) ;
+* le bloc précédent, entièrement émis, est rendu au lecteur.
+*/
+static const unsigned char *lire_bloc(int *taille_msg)
+{
+    const unsigned char *donnees;
+    size_t reste;
+
+    if (bloc_lu != NULL && position_bloc == bloc_lu->taille) {
+        anneau_liberer(&anneau_lecture);
+        bloc_lu = NULL;
+    }
+    if (bloc_lu == NULL) {
+        bloc_lu = anneau_consommer(&anneau_lecture);
+        position_bloc = 0;
+    }
+    reste = bloc_lu->taille - position_bloc;
+    *taille_msg = reste < (size_t)lecture_max ? (int)reste : lecture_max;
+    donnees = bloc_lu->donnees + position_bloc;
+    position_bloc += *taille_msg;
+    return donnees;
+}
+
+/*
+* Fin du fichier à émettre : projection ou thread lecteur libérés.
+*/
+static void fermer_fichier_emission()
+{
+    if (pipeline) {
+        pthread_join(lecteur, NULL);
+        anneau_detruire(&anneau_lecture);
+        bloc_lu = NULL;
+    }
+    else if (projection != NULL)
+        munmap(debut_projection, taille_projection);
+    projection = NULL;
+    fichier_ouvert = 2;
+}
+
+/*
+* Lecture sans copie : renvoie un pointeur sur les prochaines données
+* (au plus TAILLE_INFO octets) directement dans le fichier projeté, ou
+* dans le bloc lu par le thread lecteur en mode pipeline (le pointeur
+* n'est alors valide que jusqu'à l'appel suivant).
+* Paramètres (en sortie):
+*  - taille_msg : nombre d'octets de données à émettre (0 en fin de fichier)
+*/
+const unsigned char *de_application_ptr(int *taille_msg)
+{
+    const unsigned char *donnees;
+
+    if (!fichier_ouvert)
+        ouvrir_fichier_emission();
+
+    if (fichier_ouvert == 1) {
+        donnees = pipeline ? lire_bloc(taille_msg) : lire_projection(taille_msg);
+        if (*taille_msg > 0) {
+            TRACE(TRACE_PACKET, "\n[APP] Lecture fichier.\n");
+            return donnees;
+        }
+        fermer_fichier_emission();
+        TRACE(TRACE_EVENT, "[APP] Fin du fichier.\n");
+    }
+
+    /* fin du fichier : message vide, à transmettre au récepteur */
+    *taille_msg = 0;
+    return (const unsigned char *)"";
+}
 
 /*
 * Lecture de données émanant de la couche application.
 * Paramètres (en sortie):
 *  - donnees : message devant être envoyé (issu de la couche application)
-*  - taille_msg : nombre d'octets de données à émettre (0 si pas de données)
+*  - taille_msg : nombre d'octets de données à émettre (0 en fin de fichier)
 */
 void de_application(unsigned char *message, int *taille_msg)
 {
-    /* test état fichier */
-    if (fichier == NULL) {
-        /* fichier non ouvert, ouverture en lecture */
-        char nom_fichier[30];
+    const unsigned char *donnees = de_application_ptr(taille_msg);
+
+    if (*taille_msg > 0)
+        memcpy(message, donnees, *taille_msg);
+}
+
+void choisir_fichier_emission(const char *nom)
+{
+    fichier_choisi = nom;
+}
+
+void choisir_troncon_emission(uint64_t decalage, uint64_t taille)
+{
+    debut_troncon = decalage;
+    taille_troncon = taille;
+}
+
+uint64_t taille_fichier_emission()
+{
+    char nom_fichier[MAX_FILE_NAME];
+    struct stat st;
+
+    if (fichier_choisi != NULL)
+        snprintf(nom_fichier, sizeof(nom_fichier), "%s", fichier_choisi);
+    else
         conf_app_sender(nom_fichier);
-        fichier = fopen(nom_fichier, "r");
-        if (fichier == NULL) {
-            perror("[APP] Problème ouverture fichier en lecture !\n");
+    if (stat(nom_fichier, &st) < 0) {
+        perror("[APP] Problème ouverture fichier en lecture !\n");
+        exit(1);
+    }
+    return st.st_size;
+}
+
+/*
+* Ecriture de taille octets dans le fichier reçu, à sa position courante
+* (écriture positionnée : plusieurs tronçons d'un même fichier peuvent
+* être écrits en même temps).
+*/
+static void ecrire_tout(fichier_recu_t *fichier, const unsigned char *donnees, size_t taille)
+{
+    size_t ecrit = 0;
+
+    while (ecrit < taille) {
+        ssize_t n = pwrite(fichier->fd, donnees + ecrit, taille - ecrit, fichier->position + ecrit);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            perror("[APP] Problème écriture fichier !\n");
             exit(1);
         }
+        ecrit += n;
     }
+    fichier->position += taille;
+    latence_disque(taille);
+}
 
-    if ( !feof(fichier) ) {
-        /* lecture du fichier, au max LECTURE_MAX données */
-        /* fread(void *restrict ptr, size_t size, size_t nitems,
-        *       FILE *restrict stream); */
-        *taille_msg = fread(message, 1, LECTURE_MAX, fichier);
-        printf("\n[APP] Lecture fichier.\n");
+/*
+* Thread écrivain d'un fichier reçu (mode pipeline) : écriture des blocs
+* publiés dans l'anneau, jusqu'au bloc vide de fin de fichier.
+*/
+static void *ecrire_fichier(void *arg)
+{
+    fichier_recu_t *fichier = arg;
+    bloc_t *bloc;
+
+    do {
+        bloc = anneau_consommer(&fichier->anneau);
+        ecrire_tout(fichier, bloc->donnees, bloc->taille);
+        anneau_liberer(&fichier->anneau);
+    } while (bloc->taille > 0);
+    return NULL;
+}
+
+/*
+* Ouverture d'un fichier reçu, avec un tampon de capacite octets
+* (en mode pipeline : un anneau de NB_BLOCS blocs et son écrivain).
+* Pour un tronçon (taille_fichier > 0), le fichier n'est pas vidé mais
+* amené à sa taille finale, et l'écriture commence à decalage.
+*/
+static fichier_recu_t *creer_fichier_recu(const char *chemin, size_t capacite,
+                                          uint64_t taille_fichier, uint64_t decalage)
+{
+    fichier_recu_t *fichier = malloc(sizeof(fichier_recu_t));
+
+    if (fichier == NULL)
+        return NULL;
+    lire_conf_pipeline();
+    fichier->fd = open(chemin, O_WRONLY | O_CREAT | (taille_fichier > 0 ? 0 : O_TRUNC), 0644);
+    fichier->position = decalage;
+    if (fichier->fd >= 0 && taille_fichier > 0) {
+        /* préallocation (best effort) : les tronçons écrits en même temps
+         * ne fragmentent pas le fichier */
+        if (ftruncate(fichier->fd, taille_fichier) < 0) {
+            close(fichier->fd);
+            fichier->fd = -1;
+        }
+        else
+            posix_fallocate(fichier->fd, 0, taille_fichier);
+    }
+    fichier->tampon = pipeline ? NULL : malloc(capacite);
+    fichier->capacite = capacite;
+    fichier->rempli = 0;
+    fichier->bloc = NULL;
+    fichier->capacite_bloc = capacite / NB_BLOCS;
+    if (fichier->fd >= 0 && pipeline) {
+        if (anneau_init(&fichier->anneau, NB_BLOCS, sizeof(bloc_t) + fichier->capacite_bloc) < 0)
+            fichier->capacite_bloc = 0;
+        else if (pthread_create(&fichier->ecrivain, NULL, ecrire_fichier, fichier) != 0) {
+            anneau_detruire(&fichier->anneau);
+            fichier->capacite_bloc = 0;
+        }
+    }
+    if (fichier->fd < 0 || (pipeline ? fichier->capacite_bloc == 0 : fichier->tampon == NULL)) {
+        if (fichier->fd >= 0)
+            close(fichier->fd);
+        free(fichier->tampon);
+        free(fichier);
+        return NULL;
+    }
+    return fichier;
+}
+
+/*
+* Ecriture de tout le tampon dans le fichier reçu.
+*/
+static void vider_tampon(fichier_recu_t *fichier)
+{
+    ecrire_tout(fichier, fichier->tampon, fichier->rempli);
+    fichier->rempli = 0;
+}
+
+/*
+* Mode pipeline : publication du bloc en cours au thread écrivain.
+*/
+static void publier_bloc(fichier_recu_t *fichier)
+{
+    if (fichier->bloc == NULL) {
+        fichier->bloc = anneau_produire(&fichier->anneau);
+        fichier->bloc->taille = 0;
     }
-    else {
-        *taille_msg = 0;
-        printf("[APP] Fin du fichier.\n");
-        fclose(fichier);
+    anneau_publier(&fichier->anneau);
+    fichier->bloc = NULL;
+}
+
+fichier_recu_t *ouvrir_troncon_recu(const char *nom, uint64_t taille_fichier, uint64_t decalage)
+{
+    char sortie_conf[MAX_FILE_NAME];
+    char chemin[MAX_FILE_NAME + LG_NOM_MAX + 1];
+    const char *separateur;
+
+    conf_app_receiver(sortie_conf);
+    if (nom[0] == '\0')
+        return creer_fichier_recu(sortie_conf, TAMPON_FLUX, taille_fichier, decalage);
+
+    /* pas de chemin : le fichier reste dans le répertoire de FICHIER_OUT */
+    if (nom[0] == '.' || strchr(nom, '/') != NULL)
+        return NULL;
+    separateur = strrchr(sortie_conf, '/');
+    snprintf(chemin, sizeof(chemin), "%.*s%s",
+             separateur != NULL ? (int)(separateur - sortie_conf + 1) : 0, sortie_conf, nom);
+    return creer_fichier_recu(chemin, TAMPON_FLUX, taille_fichier, decalage);
+}
+
+fichier_recu_t *ouvrir_fichier_recu(const char *nom)
+{
+    return ouvrir_troncon_recu(nom, 0, 0);
+}
+
+void ecrire_fichier_recu(fichier_recu_t *fichier, const unsigned char *donnees, int taille_msg)
+{
+    if (fichier->tampon == NULL) {
+        /* mode pipeline : copie dans les blocs de l'anneau */
+        while (taille_msg > 0) {
+            if (fichier->bloc == NULL) {
+                fichier->bloc = anneau_produire(&fichier->anneau);
+                fichier->bloc->taille = 0;
+            }
+            size_t n = fichier->capacite_bloc - fichier->bloc->taille;
+            if (n > (size_t)taille_msg)
+                n = taille_msg;
+            memcpy(fichier->bloc->donnees + fichier->bloc->taille, donnees, n);
+            fichier->bloc->taille += n;
+            donnees += n;
+            taille_msg -= n;
+            if (fichier->bloc->taille == fichier->capacite_bloc)
+                publier_bloc(fichier);
+        }
+        return;
+    }
+    if (fichier->rempli + taille_msg > fichier->capacite)
+        vider_tampon(fichier);
+    memcpy(fichier->tampon + fichier->rempli, donnees, taille_msg);
+    fichier->rempli += taille_msg;
+}
+
+void fermer_fichier_recu(fichier_recu_t *fichier)
+{
+    if (fichier->tampon == NULL) {
+        /* dernier bloc, puis bloc vide : fin de l'écrivain */
+        if (fichier->bloc != NULL && fichier->bloc->taille > 0)
+            publier_bloc(fichier);
+        publier_bloc(fichier);
+        pthread_join(fichier->ecrivain, NULL);
+        anneau_detruire(&fichier->anneau);
     }
+    else
+        vider_tampon(fichier);
+    close(fichier->fd);
+    free(fichier->tampon);
+    free(fichier);
 }
 
 /*
 * Remise de données à la couche application.
 * Paramètres (en entrée):
 *  - donnees : données à remonter à l'application
-*  - taille_msg : taille des données
+*  - taille_msg : taille des données (0 : fin du fichier)
 * Renvoie :
 *    -> 1 si le récepteur n'a plus rien à écrire (fichier terminé)
 *    -> 0 sinon
@@ -62,28 +523,25 @@ int vers_application(unsigned char *message, int taille_msg)
 {
 
     /* test état fichier */
-    if (fichier == NULL) {
+    if (sortie == NULL) {
         /* fichier non ouvert, ouverture en écriture */
-        char nom_fichier[30];
+        char nom_fichier[MAX_FILE_NAME];
         conf_app_receiver(nom_fichier);
-        fichier = fopen(nom_fichier, "w");
-        if (fichier == NULL) {
+        sortie = creer_fichier_recu(nom_fichier, TAMPON_ECRITURE, 0, 0);
+        if (sortie == NULL) {
             perror("[APP] Problème ouverture fichier en écriture !\n");
             exit(1);
         }
     }
 
-    /* écriture des données dans le fichier */
-    printf("[APP] Ecriture fichier.\n");
-    fwrite(message, 1, taille_msg, fichier);
-    fflush(fichier);
+    /* écriture des données dans le tampon, vidé quand il est plein */
+    TRACE(TRACE_PACKET, "[APP] Ecriture fichier.\n");
+    ecrire_fichier_recu(sortie, message, taille_msg);
 
-    if (taille_msg < LECTURE_MAX) {
-        /* c'etait la derniere partie du fichier car taille message < LECTURE_MAX */
-        /* ATTENTION HYPOTHESE FORTE...
-        --> problème si LECTURE_MAX est un multiple de la taille du message */
-        fclose(fichier);
-        printf("[APP] Fichier fermé.\n");
+    if (taille_msg == 0) {
+        /* message vide : fin du fichier signalée par l'émetteur */
+        fermer_fichier_recu(sortie);
+        TRACE(TRACE_EVENT, "[APP] Fichier fermé.\n");
         return 1;
     }
     return 0;
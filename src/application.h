@@ -1,11 +1,21 @@
 #ifndef __APPLICATION_H__
 #define __APPLICATION_H__
 
+#include <stdint.h> /* uint64_t */
+
 /****************************************
  * Interface avec la couche application *
  ****************************************/
 
-#define LECTURE_MAX 124
+/* Les données sont lues par blocs de TAILLE_INFO octets (cf. config.txt,
+ * 124 par défaut) : le tampon passé à de_application() doit pouvoir
+ * contenir MAX_INFO octets.
+ * La fin du fichier est un message vide (taille_msg == 0) : l'émetteur
+ * le transmet comme les autres, et sa remise au récepteur ferme le
+ * fichier. Côté récepteur, les écritures sont regroupées et le fichier
+ * n'est complet qu'une fois que vers_application() a renvoyé 1.
+ * Avec PIPELINE_APPLI 1, le fichier est lu (émetteur) ou écrit
+ * (récepteur, un thread par fichier reçu) par un thread séparé. */
 
 /* =========================================================== */
 /* ==================== Mode non connecté ==================== */
@@ -15,19 +25,78 @@
  * Lecture de données émanant de la couche application.
  * Paramètres (en sortie):
  *  - donnees : message devant être envoyé (issu de la couche application)
- *  - taille_msg : nombre d'octets de données à émettre (0 si pas de données)
+ *  - taille_msg : nombre d'octets de données à émettre (0 en fin de
+ *    fichier : ce message vide doit être transmis au récepteur)
  */
 void de_application(unsigned char *donnees, int *taille_msg);
 
+/*
+ * Variante sans copie de de_application() : la fonction renvoie un
+ * pointeur sur les données suivantes (dans le fichier projeté en
+ * mémoire, ou dans un bloc lu par le thread lecteur si PIPELINE_APPLI
+ * vaut 1), valide jusqu'à l'appel suivant.
+ * Paramètre (en sortie):
+ *  - taille_msg : nombre d'octets de données à émettre (0 en fin de fichier)
+ */
+const unsigned char *de_application_ptr(int *taille_msg);
+
 /*
  * Remise de données à la couche application.
  * Paramètres (en entrée):
  *  - donnees : données à remonter à l'application
- *  - taille_msg : taille des données en octets
+ *  - taille_msg : taille des données en octets (0 : fin du fichier)
  * Renvoie :
  *    -> 1 si le récepteur n'a plus rien à écrire (fichier terminé)
  *    -> 0 sinon
  */
 int vers_application(unsigned char *donnees, int taille_msg);
 
+/* =========================================================== */
+/* ========= Mode connecté : plusieurs fichiers reçus ======== */
+/* =========================================================== */
+
+/*
+ * Emetteur : fichier à émettre à la place de FICHIER_IN
+ * (à appeler avant la première lecture).
+ */
+void choisir_fichier_emission(const char *nom);
+
+/*
+ * Emetteur : taille du fichier à émettre, et tronçon de ce fichier
+ * (taille octets à partir de decalage) à émettre à sa place, pour un
+ * transfert en plusieurs flux (à appeler avant la première lecture).
+ */
+uint64_t taille_fichier_emission();
+void choisir_troncon_emission(uint64_t decalage, uint64_t taille);
+
+/* Fichier en cours de réception (un par connexion) */
+typedef struct fichier_recu_s fichier_recu_t;
+
+/*
+ * Ouverture en écriture d'un fichier reçu.
+ * Paramètre (en entrée):
+ *  - nom : nom du fichier, créé dans le répertoire de FICHIER_OUT
+ *    ("" : FICHIER_OUT lui-même) ; ni '/' ni '.' initial.
+ * Renvoie NULL si le nom est refusé ou si le fichier ne peut être créé.
+ */
+fichier_recu_t *ouvrir_fichier_recu(const char *nom);
+
+/*
+ * Variante de ouvrir_fichier_recu() pour un tronçon : le fichier n'est
+ * pas vidé mais amené à taille_fichier octets, et les données reçues
+ * sont écrites à partir de decalage (plusieurs processus peuvent écrire
+ * en même temps des tronçons disjoints d'un même fichier).
+ */
+fichier_recu_t *ouvrir_troncon_recu(const char *nom, uint64_t taille_fichier, uint64_t decalage);
+
+/*
+ * Ecriture (regroupée) de taille_msg octets dans le fichier.
+ */
+void ecrire_fichier_recu(fichier_recu_t *fichier, const unsigned char *donnees, int taille_msg);
+
+/*
+ * Fermeture du fichier, une fois toutes les données écrites.
+ */
+void fermer_fichier_recu(fichier_recu_t *fichier);
+
 #endif
@@ -8,15 +8,46 @@
 #include <stdlib.h>
 #include <string.h>
 #include "config.h"
+#include "couche_transport.h" /* MAX_INFO, TAILLE_INFO_DEFAUT */
+#include "trace.h" /* TRACE_OFF..TRACE_PACKET */
 
-#define MAX_LINE 80
-#define MAX_PARAM_NAME 32
-#define MAX_PARAM_VALUE 32
+#define MAX_LINE (MAX_FILE_NAME + 32)
+#define MAX_PARAM_NAME MAX_LINE
+#define MAX_PARAM_VALUE MAX_LINE
 
 /* =========================================== */
 /* ============ CONF NETWORK LAYER =========== */
 /* =========================================== */
 
+/* Network backend (BACKEND_RESEAU) */
+/* -------------------------------- */
+static int conf_backend(char *value) {
+
+    if ( !strcmp(value, "io_uring") )
+        return BACKEND_URING;
+    if ( strcmp(value, "socket") ) {
+        fprintf(stderr, "[Config] BACKEND_RESEAU doit valoir socket ou io_uring.\n");
+        exit(1);
+    }
+    return BACKEND_SOCKET;
+}
+
+/* Sender pacing (RYTHME_EMISSION) */
+/* -------------------------------- */
+static long conf_pacing(char *value) {
+
+    if ( !strcmp(value, "aucun") )
+        return PACING_NONE;
+    if ( !strcmp(value, "auto") )
+        return PACING_AUTO;
+    double mbps = atof(value);
+    if (mbps <= 0) {
+        fprintf(stderr, "[Config] RYTHME_EMISSION doit valoir aucun, auto ou un debit (Mbit/s).\n");
+        exit(1);
+    }
+    return (long)(mbps * 1e6 / 8);
+}
+
 /* Configure sender's network layer */
 /* -------------------------------- */
 void conf_net_sender(netlib_config_t *nl_conf) {
@@ -42,10 +73,18 @@ void conf_net_sender(netlib_config_t *nl_conf) {
                 nl_conf->loss_proba = atof(param_value);
             else if ( !strcmp(param_name, ERROR_PROBA_S) )
                 nl_conf->error_proba = atof(param_value);
+            else if ( !strcmp(param_name, ERROR_BITS) )
+                nl_conf->error_bits = atoi(param_value);
             else if ( !strcmp(param_name, LOSS_CONNECTION_REQ) )
                 nl_conf->loss_connect = atoi(param_value);
             else if ( !strcmp(param_name, LOSS_DECONNECTION) )
                 nl_conf->loss_disconnect = atoi(param_value);
+            else if ( !strcmp(param_name, NET_BACKEND) )
+                nl_conf->backend = conf_backend(param_value);
+            else if ( !strcmp(param_name, PACING) )
+                nl_conf->pacing_rate = conf_pacing(param_value);
+            else if ( !strcmp(param_name, PACING_TXTIME) )
+                nl_conf->pacing_txtime = atoi(param_value);
             else if ( !strcmp(param_name, PLOT_PERIOD_THROUGHPUT) )
                 nl_conf->plot_period_ms = atoi(param_value);
         }
@@ -77,10 +116,14 @@ void conf_net_receiver(netlib_config_t *nl_conf) {
                 nl_conf->loss_proba = atof(param_value);
             else if ( !strcmp(param_name, ERROR_PROBA_R) )
                 nl_conf->error_proba = atof(param_value);
+            else if ( !strcmp(param_name, ERROR_BITS) )
+                nl_conf->error_bits = atoi(param_value);
             else if ( !strcmp(param_name, LOSS_CONNECTION_REP) )
                 nl_conf->loss_connect = atoi(param_value);
             else if ( !strcmp(param_name, LOSS_DECONNECTION_ACK) )
                 nl_conf->loss_disconnect = atoi(param_value);
+            else if ( !strcmp(param_name, NET_BACKEND) )
+                nl_conf->backend = conf_backend(param_value);
             else if ( !strcmp(param_name, LOSS_LAST_ACK) )
                 nl_conf->loss_last_ack = atoi(param_value);            
         }
@@ -89,18 +132,17 @@ void conf_net_receiver(netlib_config_t *nl_conf) {
 }
 
 /* =========================================== */
-/* ========== CONF APPLICATION LAYER ========= */
+/* =========== SINGLE PARAMETER READ ========= */
 /* =========================================== */
 
-/* Configure application layer          */
-/* role == 0 sender, role 1 == receiver */
-/* ------------------------------------ */
-void conf_app(int role, char *file_name) {
+/* Parameter name copied into value, 0 if not set */
+/* ---------------------------------------------- */
+static int conf_str(const char *name, char *value) {
 
+    int found = 0;
     FILE *f = NULL;
     char line[MAX_LINE];
     char param_name[MAX_PARAM_NAME], param_value[MAX_PARAM_VALUE];
-    int found = 0;
 
     f = fopen(CONF_FILE, "r");
     if (f == NULL) {
@@ -108,25 +150,50 @@ void conf_app(int role, char *file_name) {
         exit(1);
     }
 
-    /* fgets(char[] dest, int size, FILE* stream); */
-    while ( !found && fgets(line, sizeof(line), f) ) {
+    while ( fgets(line, sizeof(line), f) ) {
 
         if (line[0] != '#' && line[0] != '\n') {
-            // printf("line : %s", line);
             sscanf(line, "%s%s", param_name, param_value);
-            // printf("\t param name %s -- param value %s\n", param_name, param_value);
-            if ( (role == 0 && !strcmp(param_name, FILE_TO_SEND)) ||
-                 (role == 1 && !strcmp(param_name, FILE_TO_RECEIVE)) ) {
-                strcpy(file_name, param_value);
+            if ( !strcmp(param_name, name) ) {
+                strcpy(value, param_value);
                 found = 1;
             }
         }
     }
     fclose(f);
-    if (!found) {
+    return found;
+}
+
+/* Integer parameter name, default_value if not set */
+/* ------------------------------------------------ */
+static int conf_int(const char *name, int default_value) {
+
+    char value[MAX_PARAM_VALUE];
+
+    return conf_str(name, value) ? atoi(value) : default_value;
+}
+
+/* =========================================== */
+/* ========== CONF APPLICATION LAYER ========= */
+/* =========================================== */
+
+/* Configure application layer          */
+/* role == 0 sender, role 1 == receiver */
+/* ------------------------------------ */
+void conf_app(int role, char *file_name) {
+
+    char param_value[MAX_PARAM_VALUE];
+
+    if ( !conf_str(role == 0 ? FILE_TO_SEND : FILE_TO_RECEIVE, param_value) ) {
         perror("[Config] Problème, nom du fichier (à envoyer ou recevoir) non présent dans configuration.\n");
         exit(1);        
     }
+    if (strlen(param_value) >= MAX_FILE_NAME) {
+        fprintf(stderr, "[Config] Nom de fichier trop long (%d caractères max).\n",
+                MAX_FILE_NAME - 1);
+        exit(1);
+    }
+    strcpy(file_name, param_value);
 }
 
 /* Configure sender's application layer */
@@ -142,3 +209,106 @@ void conf_app_receiver(char *file_to_receive) {
 
     conf_app(1, file_to_receive);
 }
+
+/* =========================================== */
+/* ============ CONF PAYLOAD SIZE ============ */
+/* =========================================== */
+
+/* Payload size (TAILLE_INFO), TAILLE_INFO_DEFAUT if not set */
+/* --------------------------------------------------------- */
+static int info_size = 0; /* read once, or negotiated */
+
+int conf_info_size() {
+
+    if (info_size != 0)
+        return info_size;
+
+    info_size = conf_int(PAYLOAD_SIZE, TAILLE_INFO_DEFAUT);
+    if (info_size < 1 || info_size > MAX_INFO) {
+        fprintf(stderr, "[Config] TAILLE_INFO doit etre comprise entre 1 et %d.\n", MAX_INFO);
+        exit(1);
+    }
+    return info_size;
+}
+
+void conf_set_info_size(int size) {
+
+    info_size = size;
+}
+
+/* Trace level (NIVEAU_TRACE), TRACE_EVENT if not set */
+/* -------------------------------------------------- */
+int conf_trace_level() {
+
+    int level = conf_int(TRACE_LEVEL, TRACE_EVENT);
+
+    if (level < TRACE_OFF || level > TRACE_PACKET) {
+        fprintf(stderr, "[Config] NIVEAU_TRACE doit etre compris entre %d et %d.\n",
+                TRACE_OFF, TRACE_PACKET);
+        exit(1);
+    }
+    return level;
+}
+
+/* Pipelined application layer (PIPELINE_APPLI), off if not set */
+/* ------------------------------------------------------------ */
+int conf_app_pipeline() {
+
+    return conf_int(APP_PIPELINE, 0) != 0;
+}
+
+/* Simulated storage latency (LATENCE_DISQUE_MS), 0 if not set */
+/* ----------------------------------------------------------- */
+int conf_disk_latency_ms() {
+
+    int latency = conf_int(DISK_LATENCY, 0);
+
+    if (latency < 0) {
+        fprintf(stderr, "[Config] LATENCE_DISQUE_MS doit etre positive.\n");
+        exit(1);
+    }
+    return latency;
+}
+
+/* Delayed ACKs: one ACK every ACK_DIFFERE packets (1 if not set) */
+/* ------------------------------------------------------------- */
+int conf_ack_every() {
+
+    int every = conf_int(ACK_EVERY, 1);
+
+    if (every < 1 || every > 8) {
+        fprintf(stderr, "[Config] ACK_DIFFERE doit etre entre 1 et 8.\n");
+        exit(1);
+    }
+    return every;
+}
+
+/* Delayed ACKs: longest delay (DELAI_ACK_US, 200 us if not set) */
+/* ------------------------------------------------------------ */
+long conf_ack_delay_us() {
+
+    int delay = conf_int(ACK_DELAY, 200);
+
+    if (delay < 1) {
+        fprintf(stderr, "[Config] DELAI_ACK_US doit etre positif.\n");
+        exit(1);
+    }
+    return delay;
+}
+
+/* Sender congestion control (CONTROLE_CONGESTION), none if not set */
+/* ---------------------------------------------------------------- */
+int conf_congestion() {
+
+    char value[MAX_PARAM_VALUE];
+
+    if ( !conf_str(CONGESTION, value) || !strcmp(value, "aucun") )
+        return CC_NONE;
+    if ( !strcmp(value, "aimd") )
+        return CC_AIMD;
+    if ( strcmp(value, "cubic") ) {
+        fprintf(stderr, "[Config] CONTROLE_CONGESTION doit valoir aucun, aimd ou cubic.\n");
+        exit(1);
+    }
+    return CC_CUBIC;
+}
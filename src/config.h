@@ -9,6 +9,9 @@
 
 #define CONF_FILE "config.txt"
 
+/* size of the buffer given to conf_app_sender/receiver() */
+#define MAX_FILE_NAME 256
+
 #define FILE_TO_SEND "FICHIER_IN"
 #define FILE_TO_RECEIVE "FICHIER_OUT"
 
@@ -18,6 +21,9 @@
 #define ERROR_PROBA_S "PROBA_ERREUR_E"
 #define ERROR_PROBA_R "PROBA_ERREUR_R"
 
+/* number of bits flipped by an error (both hosts) */
+#define ERROR_BITS "BITS_ERREUR"
+
 #define LOSS_CONNECTION_REQ "PERTE_CON_REQ"
 #define LOSS_CONNECTION_REP "PERTE_CON_ACCEPT"
 
@@ -28,14 +34,59 @@
 
 #define PLOT_PERIOD_THROUGHPUT "PERIODE_CALCUL_DEBIT"
 
+#define PAYLOAD_SIZE "TAILLE_INFO"
+
+#define TRACE_LEVEL "NIVEAU_TRACE"
+
+/* application layer: file read / written by a separate thread (0 or 1) */
+#define APP_PIPELINE "PIPELINE_APPLI"
+
+/* application layer: simulated storage latency (ms per block read or
+ * written, 0 by default) */
+#define DISK_LATENCY "LATENCE_DISQUE_MS"
+
+/* receiver: one ACK every ACK_DIFFERE in-order data packets (1 by
+ * default: one ACK per packet), or DELAI_ACK_US after the first
+ * unacknowledged one (200 us by default) */
+#define ACK_EVERY "ACK_DIFFERE"
+#define ACK_DELAY "DELAI_ACK_US"
+
+/* socket calls ("socket", default) or io_uring ring ("io_uring") */
+#define NET_BACKEND "BACKEND_RESEAU"
+#define BACKEND_SOCKET 0
+#define BACKEND_URING 1
+
+/* sender pacing: none ("aucun", default), rate derived from the
+ * congestion window and the smoothed RTT ("auto"), or fixed rate in
+ * Mbit/s */
+#define PACING "RYTHME_EMISSION"
+#define PACING_NONE 0
+#define PACING_AUTO -1
+/* paced departures held by the kernel (SO_TXTIME) instead of a local
+ * timer queue: 0 (default) or 1, only if the egress device uses the fq
+ * or etf qdisc (the others ignore the departure date) */
+#define PACING_TXTIME "RYTHME_TXTIME"
+
+/* sender congestion window: fixed ("aucun", default), "aimd" or "cubic"
+ * (see controle_congestion.h) */
+#define CONGESTION "CONTROLE_CONGESTION"
+#define CC_NONE 0
+#define CC_AIMD 1
+#define CC_CUBIC 2
+
 // Network layer config.
 typedef struct netlib_config_s {
     float loss_proba;
     float error_proba;
+    int error_bits;
     int loss_connect;
     int loss_disconnect;
     int loss_last_ack;
     int plot_period_ms;
+    int info_size;
+    int backend;
+    long pacing_rate; /* bytes/s, PACING_NONE or PACING_AUTO */
+    int pacing_txtime;
 } netlib_config_t;
 
 void conf_app_sender(char *file_to_send);
@@ -44,4 +95,28 @@ void conf_net_sender(netlib_config_t *nl_conf);
 void conf_app_receiver(char *file_to_receive);
 void conf_net_receiver(netlib_config_t *nl_conf);
 
+/* Payload size shared by the application and network layers
+ * (TAILLE_INFO, same value on both hosts) */
+int conf_info_size();
+
+/* Overrides TAILLE_INFO for this process (connected mode: value
+ * negotiated with the peer), before the first data is read */
+void conf_set_info_size(int size);
+
+/* Run time trace level (NIVEAU_TRACE, see trace.h) */
+int conf_trace_level();
+
+/* Pipelined application layer (PIPELINE_APPLI, 0 by default) */
+int conf_app_pipeline();
+
+/* Simulated storage latency (LATENCE_DISQUE_MS, 0 by default) */
+int conf_disk_latency_ms();
+
+/* Delayed ACKs (ACK_DIFFERE, 1 by default, and DELAI_ACK_US) */
+int conf_ack_every();
+long conf_ack_delay_us();
+
+/* Sender congestion control (CONTROLE_CONGESTION, CC_NONE by default) */
+int conf_congestion();
+
 #endif
@@ -0,0 +1,165 @@
+/*************************************************************
+* Contrôle de congestion de l'émetteur                       *
+*                                                            *
+* Démarrage lent commun (+1 paquet par paquet acquitté tant  *
+* que cwnd < ssthresh), puis évitement de congestion et      *
+* réduction sur perte propres à chaque algorithme, choisis   *
+* par une table de fonctions.                                *
+**************************************************************/
+
+#include <stddef.h> /* NULL */
+#include <math.h>
+#include "controle_congestion.h"
+#include "config.h"
+#include "services_reseau.h"
+
+#define CWND_MIN 2.0
+#define CUBIC_BETA 0.7
+#define CUBIC_C 0.4  /* paquets / s^3 */
+
+struct algo_congestion_s {
+    const char *nom;
+    /* croissance hors démarrage lent (nb paquets acquittés) */
+    void (*evitement)(congestion_t *cc, int nb, long srtt_us, long long maintenant);
+    /* réduction multiplicative sur perte */
+    void (*reduction)(congestion_t *cc, long long maintenant);
+};
+
+/* AIMD : +1 paquet par fenêtre acquittée, divisée par 2 sur perte */
+static void aimd_evitement(congestion_t *cc, int nb, long srtt_us, long long maintenant)
+{
+    (void)srtt_us;
+    (void)maintenant;
+    cc->cwnd += (double)nb / cc->cwnd;
+}
+
+static void aimd_reduction(congestion_t *cc, long long maintenant)
+{
+    (void)maintenant;
+    cc->cwnd = fmax(cc->cwnd / 2, CWND_MIN);
+    cc->ssthresh = cc->cwnd;
+}
+
+/* CUBIC : W(t) = C (t - K)^3 + w_max, t depuis le début de l'époque ;
+ * jamais moins que la fenêtre d'AIMD équivalent (w_est). K est le
+ * temps pour remonter de la fenêtre de début d'époque à w_max (nul si
+ * elle l'atteint déjà) */
+static void cubic_debut_epoque(congestion_t *cc, long long maintenant)
+{
+    cc->debut_epoque = maintenant;
+    cc->k = cbrt(fmax(cc->w_max - cc->cwnd, 0) / CUBIC_C);
+    cc->w_est = cc->cwnd;
+}
+
+static void cubic_evitement(congestion_t *cc, int nb, long srtt_us, long long maintenant)
+{
+    double t, cible;
+
+    if (cc->debut_epoque == 0) {
+        /* sortie du démarrage lent : plateau à la fenêtre de la dernière
+         * expiration, à la fenêtre courante si aucune perte ne l'a fixé */
+        if (cc->w_max < cc->cwnd)
+            cc->w_max = cc->cwnd;
+        cubic_debut_epoque(cc, maintenant);
+    }
+    /* fenêtre visée un RTT plus tard */
+    t = (maintenant - cc->debut_epoque + srtt_us) / 1e6;
+    cible = CUBIC_C * (t - cc->k) * (t - cc->k) * (t - cc->k) + cc->w_max;
+    cc->w_est += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) * nb / cc->cwnd;
+    if (cible < cc->w_est)
+        cible = cc->w_est;
+    if (cible > cc->cwnd)
+        cc->cwnd += (cible - cc->cwnd) / cc->cwnd * nb;
+}
+
+static void cubic_reduction(congestion_t *cc, long long maintenant)
+{
+    /* convergence rapide : perte avant d'avoir retrouvé w_max */
+    if (cc->cwnd < cc->w_max)
+        cc->w_max = cc->cwnd * (1 + CUBIC_BETA) / 2;
+    else
+        cc->w_max = cc->cwnd;
+    cc->cwnd = fmax(cc->cwnd * CUBIC_BETA, CWND_MIN);
+    cc->ssthresh = cc->cwnd;
+    cubic_debut_epoque(cc, maintenant);
+}
+
+/* indexée par CC_* (config.h) */
+static const algo_congestion_t algos[] = {
+    [CC_NONE]  = { "aucun", NULL, NULL },
+    [CC_AIMD]  = { "aimd", aimd_evitement, aimd_reduction },
+    [CC_CUBIC] = { "cubic", cubic_evitement, cubic_reduction },
+};
+
+void congestion_init(congestion_t *cc, int algo, int fenetre_max)
+{
+    cc->algo = &algos[algo];
+    cc->fenetre_max = fenetre_max;
+    cc->cwnd = algo == CC_NONE ? fenetre_max : 1;
+    cc->ssthresh = fenetre_max;
+    cc->derniere_reduction = 0;
+    cc->w_max = 0; /* pas encore de perte */
+    cc->k = 0;
+    cc->w_est = 0;
+    cc->debut_epoque = 0;
+}
+
+void congestion_acquittement(congestion_t *cc, int nb, long srtt_us)
+{
+    if (cc->algo->evitement == NULL || nb <= 0)
+        return;
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += nb;
+        if (cc->cwnd > cc->ssthresh)
+            cc->cwnd = cc->ssthresh;
+    } else
+        cc->algo->evitement(cc, nb, srtt_us, horloge_us());
+    /* pas de croissance au-delà de ce que la fenêtre négociée utilise */
+    if (cc->cwnd > 2.0 * cc->fenetre_max)
+        cc->cwnd = 2.0 * cc->fenetre_max;
+}
+
+/* Une seule réduction par RTT : les pertes d'une même fenêtre
+ * relèvent du même épisode de congestion */
+static int reduction_permise(congestion_t *cc, long srtt_us, long long maintenant)
+{
+    if (cc->derniere_reduction != 0 && maintenant - cc->derniere_reduction < srtt_us)
+        return 0;
+    cc->derniere_reduction = maintenant;
+    return 1;
+}
+
+void congestion_perte(congestion_t *cc, long srtt_us)
+{
+    long long maintenant = horloge_us();
+
+    if (cc->algo->reduction == NULL || !reduction_permise(cc, srtt_us, maintenant))
+        return;
+    cc->algo->reduction(cc, maintenant);
+}
+
+void congestion_expiration(congestion_t *cc, long srtt_us)
+{
+    long long maintenant = horloge_us();
+
+    if (cc->algo->reduction == NULL || !reduction_permise(cc, srtt_us, maintenant))
+        return;
+    cc->w_max = cc->cwnd;
+    cc->ssthresh = fmax(cc->cwnd / 2, CWND_MIN);
+    cc->cwnd = 1;
+    cc->debut_epoque = 0;
+}
+
+const char *congestion_nom(const congestion_t *cc)
+{
+    return cc->algo->nom;
+}
+
+int congestion_fenetre(const congestion_t *cc)
+{
+    int fenetre = (int)cc->cwnd;
+
+    if (fenetre < 1)
+        fenetre = 1;
+    return fenetre < cc->fenetre_max ? fenetre : cc->fenetre_max;
+}
@@ -0,0 +1,54 @@
+/*************************************************************
+* Contrôle de congestion de l'émetteur                       *
+*                                                            *
+* Fenêtre de congestion (cwnd, en paquets) pilotée par les   *
+* acquittements et les pertes : démarrage lent, puis         *
+* évitement de congestion selon l'algorithme choisi          *
+* (CONTROLE_CONGESTION dans config.txt) :                    *
+*  - aucun : fenêtre fixe (la fenêtre négociée)              *
+*  - aimd  : +1 paquet par RTT, divisée par 2 sur perte      *
+*  - cubic : croissance cubique autour de la fenêtre de la   *
+*            dernière perte, x 0.7 sur perte (RFC 9438)      *
+* La fenêtre effective ne dépasse jamais la fenêtre          *
+* négociée (ni donc la capacité de numérotation).            *
+**************************************************************/
+
+#ifndef __CONTROLE_CONGESTION_H__
+#define __CONTROLE_CONGESTION_H__
+
+typedef struct algo_congestion_s algo_congestion_t;
+
+typedef struct congestion_s {
+    const algo_congestion_t *algo;
+    double cwnd;               /* fenêtre de congestion (paquets) */
+    double ssthresh;           /* seuil du démarrage lent */
+    int fenetre_max;           /* fenêtre négociée */
+    long long derniere_reduction; /* date (us) : une réduction par RTT */
+    /* cubic */
+    double w_max;              /* cwnd à la dernière perte */
+    double k;                  /* durée (s) pour revenir à w_max */
+    double w_est;              /* fenêtre qu'aurait AIMD (équité TCP) */
+    long long debut_epoque;    /* date (us) de la dernière perte */
+} congestion_t;
+
+/* Initialisation : algorithme algo (CC_* de config.h), fenêtre
+ * négociée fenetre_max */
+void congestion_init(congestion_t *cc, int algo, int fenetre_max);
+
+/* nb paquets nouvellement acquittés, srtt_us : RTT lissé (0 si inconnu) */
+void congestion_acquittement(congestion_t *cc, int nb, long srtt_us);
+
+/* Perte détectée par les acquittements (trou du SACK) : réduction
+ * multiplicative, au plus une fois par RTT */
+void congestion_perte(congestion_t *cc, long srtt_us);
+
+/* Expiration d'un temporisateur : retour au démarrage lent */
+void congestion_expiration(congestion_t *cc, long srtt_us);
+
+/* Nom de l'algorithme (traces) */
+const char *congestion_nom(const congestion_t *cc);
+
+/* Fenêtre effective (paquets en vol autorisés), entre 1 et fenetre_max */
+int congestion_fenetre(const congestion_t *cc);
+
+#endif
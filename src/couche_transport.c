@@ -1,5 +1,10 @@
 #include <stdio.h>
+#include <stddef.h> /* offsetof */
+#include <string.h> /* memcpy */
+#include <unistd.h> /* getpid */
+#include <sys/random.h> /* getrandom */
 #include "couche_transport.h"
+#include "crc32c.h"
 #include "services_reseau.h"
 #include "application.h"
 
@@ -27,21 +32,357 @@ int dans_fenetre(unsigned int inf, unsigned int pointeur, int taille) {
         ( sup < inf && pointeur <= sup);
 }
 
-uint8_t generer_controle(paquet_t paquet)
+/*---------------------------------------------*/
+/* Nombre de paquets en vol dans [inf, sup[    */
+/*---------------------------------------------*/
+int en_vol(int inf, int sup) {
+
+    return (sup - inf + SEQ_NUM_SIZE) % SEQ_NUM_SIZE;
+}
+
+/* Type de somme de contrôle des paquets de données (choisir_controle) */
+static int type_controle = CTRL_CRC32C;
+
+/* Les paquets d'ouverture/fermeture de connexion gardent le CRC32C,
+ * seul type connu des deux côtés avant la négociation */
+static int controle_paquet(const paquet_t *paquet)
+{
+    if (paquet->type >= CON_REQ && paquet->type <= CON_CLOSE_ACK)
+        return CTRL_CRC32C;
+    return type_controle;
+}
+
+/* Repli sur 16 bits d'une somme en complément à un */
+static uint32_t replier(uint64_t somme)
 {
-    uint8_t checksum = paquet.type^paquet.num_seq^paquet.lg_info;
-    for(int i=0; i<paquet.lg_info; i++)
-    {
-        checksum = checksum^paquet.info[i];
+    while (somme >> 16)
+        somme = (somme & 0xffff) + (somme >> 16);
+    return somme;
+}
+
+/*--------------------------------------------------------*/
+/* Somme de l'Internet (RFC 1071) de info puis de l'en-tête */
+/* (mots de 32 bits additionnés puis repliés sur 16 bits,  */
+/* le dernier mot de info complété par des zéros)          */
+/*--------------------------------------------------------*/
+static uint32_t somme_internet(const paquet_t *paquet)
+{
+    const unsigned char *p = paquet->info;
+    size_t n = paquet->lg_info;
+    uint64_t somme = 0;
+    uint32_t mot;
+
+    while (n >= 4) {
+        memcpy(&mot, p, 4);
+        somme += mot;
+        p += 4;
+        n -= 4;
     }
-    return checksum;
+    if (n > 0) {
+        mot = 0;
+        memcpy(&mot, p, n);
+        somme += mot;
+    }
+    for (size_t i = 0; i < offsetof(paquet_t, somme_ctrl); i += 4) {
+        memcpy(&mot, (const unsigned char *)paquet + i, 4);
+        somme += mot;
+    }
+
+    return ~replier(somme) & 0xffff;
 }
 
-uint8_t verifier_controle(paquet_t paquet)
+/*--------------------------------------------------------*/
+/* Somme de contrôle : CRC32C (ou somme de l'Internet) des */
+/* lg_info octets utiles de info suivis de l'en-tête (type, */
+/* num_seq, lg_info, id_con). L'en-tête est traité en      */
+/* dernier pour que sa modification seule puisse être      */
+/* répercutée sans relire info.                            */
+/*--------------------------------------------------------*/
+uint32_t generer_controle(const paquet_t *paquet)
 {
-    return generer_controle(paquet) == paquet.somme_ctrl;
+    if (controle_paquet(paquet) == CTRL_INTERNET)
+        return somme_internet(paquet);
+
+    uint32_t crc = crc32c(0, paquet->info, paquet->lg_info);
+    return crc32c(crc, paquet, offsetof(paquet_t, somme_ctrl));
+}
+
+uint8_t verifier_controle(const paquet_t *paquet)
+{
+    return generer_controle(paquet) == paquet->somme_ctrl;
+}
+
+/*--------------------------------------------------------*/
+/* Mise à jour incrémentale de la somme de contrôle.       */
+/* CRC32C : le CRC est linéaire ; pour deux messages de    */
+/* même longueur, CRC(a) ^ CRC(b) est le CRC "brut"        */
+/* (registre initial nul, sans inversion finale) de a ^ b. */
+/* Seuls les 8 derniers octets (l'en-tête) diffèrent : le  */
+/* CRC brut de leur différence suffit, les octets nuls de  */
+/* tête ne changeant pas un registre nul.                  */
+/* Somme de l'Internet : HC' = ~(~HC + ~m + m') (RFC 1624), */
+/* m étant le mot de 16 bits (type, num_seq).              */
+/*--------------------------------------------------------*/
+void modifier_entete(paquet_t *paquet, uint8_t type, uint8_t num_seq)
+{
+    int controle = controle_paquet(paquet);
+    uint8_t delta[offsetof(paquet_t, somme_ctrl)] = { 0 };
+    uint32_t m = paquet->type | (paquet->num_seq << 8);
+
+    delta[offsetof(paquet_t, type)] = paquet->type ^ type;
+    delta[offsetof(paquet_t, num_seq)] = paquet->num_seq ^ num_seq;
+    paquet->type = type;
+    paquet->num_seq = num_seq;
+
+    if (controle_paquet(paquet) != controle) {
+        /* passage d'un paquet CON_* à un paquet de données (ou
+         * l'inverse) : les deux sommes n'ont pas le même type */
+        paquet->somme_ctrl = generer_controle(paquet);
+    }
+    else if (controle == CTRL_INTERNET) {
+        uint32_t m2 = type | (num_seq << 8);
+        paquet->somme_ctrl = ~replier((~paquet->somme_ctrl & 0xffff) + (~m & 0xffff) + m2) & 0xffff;
+    }
+    else {
+        /* crc32c(~0, ...) = ~(CRC brut) */
+        paquet->somme_ctrl ^= ~crc32c(~0u, delta, sizeof(delta));
+    }
 }
 
 int inc(int num, int mod){
     return (num + 1) % mod;
-}
\ No newline at end of file
+}
+
+/* ************************************************************************** */
+/* ************** Acquittements sélectifs (SACK) ***************************** */
+/* ************************************************************************** */
+
+void ecrire_sack(paquet_t *ack, int cumul, uint16_t masque) {
+
+    ack->info[0] = cumul;
+    ack->info[1] = masque & 0xff;
+    ack->info[2] = masque >> 8;
+    ack->lg_info = LG_SACK;
+}
+
+int lire_sack(const paquet_t *ack, int inf, int sup, int acquitte[], int nouveaux[]) {
+
+    int nb = 0, vol = en_vol(inf, sup);
+    int cumul = ack->info[0];
+    uint16_t masque = ack->info[1] | (ack->info[2] << 8);
+
+    /* cumul en retard (ACK ancien) ou au-delà des paquets émis : ignoré */
+    if (ack->lg_info != LG_SACK || !dans_fenetre(inf, cumul, vol + 1))
+        return 0;
+
+    /* acquittement cumulatif : tous les paquets avant cumul */
+    for (int i = inf; i != cumul; i = inc(i, SEQ_NUM_SIZE))
+        if (!acquitte[i]) {
+            acquitte[i] = 1;
+            nouveaux[nb++] = i;
+        }
+    /* paquets reçus hors séquence */
+    for (int b = 0; masque != 0; b++, masque >>= 1) {
+        int i = (cumul + 1 + b) % SEQ_NUM_SIZE;
+        if ((masque & 1) && dans_fenetre(inf, i, vol) && !acquitte[i]) {
+            acquitte[i] = 1;
+            nouveaux[nb++] = i;
+        }
+    }
+    return nb;
+}
+
+int trous_sack(int inf, int sup, const int acquitte[], int trous[]) {
+
+    int nb = 0, suivants = 0;
+
+    /* du plus récent au plus ancien : paquets acquittés émis après */
+    for (int i = sup; i != inf; ) {
+        i = (i - 1 + SEQ_NUM_SIZE) % SEQ_NUM_SIZE;
+        if (acquitte[i])
+            suivants++;
+        else if (suivants >= SEUIL_SACK)
+            trous[nb++] = i;
+    }
+    return nb;
+}
+
+/* ************************************************************************** */
+/* ************ Estimation adaptative du RTO (Jacobson / Karels) ************ */
+/* ************************************************************************** */
+
+static void rto_borner(rto_t *e) {
+
+    if (e->rto < RTO_MIN)
+        e->rto = RTO_MIN;
+    if (e->rto > RTO_MAX)
+        e->rto = RTO_MAX;
+}
+
+void rto_init(rto_t *e) {
+
+    e->srtt = 0;
+    e->rttvar = 0;
+    e->rto = RTO_INITIAL;
+    for (int i=0; i<SEQ_NUM_SIZE; i++)
+        e->retransmis[i] = 0;
+}
+
+void rto_emission(rto_t *e, int num_seq, int retransmission) {
+
+    if (retransmission) {
+        e->retransmis[num_seq] = 1;
+        perf_reemission();
+    }
+    else {
+        e->retransmis[num_seq] = 0;
+        e->date_envoi[num_seq] = horloge_us();
+    }
+}
+
+void rto_acquittement(rto_t *e, int num_seq) {
+
+    /* Karn : un acquittement de paquet réémis est ambigu, pas de mesure */
+    if (!e->retransmis[num_seq]) {
+
+        long rtt = horloge_us() - e->date_envoi[num_seq];
+
+        perf_rtt(rtt);
+
+        if (e->srtt == 0) {
+            /* première mesure */
+            e->srtt = rtt > 0 ? rtt : 1;
+            e->rttvar = rtt / 2;
+        }
+        else {
+            /* RTTVAR <- 3/4 RTTVAR + 1/4 |SRTT - R| ; SRTT <- 7/8 SRTT + 1/8 R */
+            long ecart = e->srtt - rtt;
+            if (ecart < 0)
+                ecart = -ecart;
+            e->rttvar = (3 * e->rttvar + ecart) / 4;
+            e->srtt = (7 * e->srtt + rtt) / 8;
+        }
+    }
+
+    /* l'acquittement prouve que le chemin fonctionne : le backoff est
+     * abandonné même sans nouvelle mesure (sinon, sous fortes pertes,
+     * tous les paquets acquittés ont été réémis et le RTO ne redescend
+     * jamais) */
+    e->rto = e->srtt ? e->srtt + 4 * e->rttvar : RTO_INITIAL;
+    rto_borner(e);
+}
+
+void rto_backoff(rto_t *e) {
+
+    e->rto *= 2;
+    rto_borner(e);
+}
+
+/* ************************************************************************** */
+/* ************** Mode connecté : paramètres négociés *********************** */
+/* ************************************************************************** */
+
+void choisir_controle(int type) {
+
+    type_controle = type;
+}
+
+int controles_supportes() {
+
+    return CTRL_CRC32C | CTRL_INTERNET | (crc32c_materiel() ? CTRL_MATERIEL : 0);
+}
+
+int negocier_controle(int local, int distant) {
+
+    int communs = local & distant;
+
+    if ( (communs & CTRL_CRC32C) && (communs & CTRL_MATERIEL) )
+        return CTRL_CRC32C;
+    if (communs & CTRL_INTERNET)
+        return CTRL_INTERNET;
+    if (communs & CTRL_CRC32C)
+        return CTRL_CRC32C;
+    return 0;
+}
+
+/* info : fenetre (1 octet), controle (1 octet), taille_info (2 octets,
+ * poids faible en tête), puis le nom du fichier reçu (sans '\0') ;
+ * pour un tronçon, suivi de '\0', taille_fichier et decalage (8 octets
+ * chacun, poids faible en tête) : un récepteur qui l'ignore refuse
+ * alors la connexion (nom invalide) */
+#define LG_PARAMETRES 4
+#define LG_TRONCON 17
+
+static void ecrire_u64(uint8_t *octets, uint64_t valeur) {
+
+    for (int i = 0; i < 8; i++)
+        octets[i] = valeur >> (8 * i);
+}
+
+static uint64_t lire_u64(const uint8_t *octets) {
+
+    uint64_t valeur = 0;
+
+    for (int i = 0; i < 8; i++)
+        valeur |= (uint64_t)octets[i] << (8 * i);
+    return valeur;
+}
+
+void ecrire_parametres(paquet_t *paquet, const parametres_t *param) {
+
+    int lg_nom = strlen(param->nom);
+
+    paquet->info[0] = param->fenetre;
+    paquet->info[1] = param->controle;
+    paquet->info[2] = param->taille_info & 0xff;
+    paquet->info[3] = param->taille_info >> 8;
+    memcpy(paquet->info + LG_PARAMETRES, param->nom, lg_nom);
+    paquet->lg_info = LG_PARAMETRES + lg_nom;
+    if (param->taille_fichier > 0) {
+        uint8_t *troncon = paquet->info + paquet->lg_info;
+        troncon[0] = '\0';
+        ecrire_u64(troncon + 1, param->taille_fichier);
+        ecrire_u64(troncon + 9, param->decalage);
+        paquet->lg_info += LG_TRONCON;
+    }
+}
+
+int lire_parametres(const paquet_t *paquet, parametres_t *param) {
+
+    int lg_nom = paquet->lg_info - LG_PARAMETRES;
+    const uint8_t *nom = paquet->info + LG_PARAMETRES;
+
+    if (lg_nom < 0)
+        return 0;
+    param->taille_fichier = param->decalage = 0;
+    /* nom suivi d'un descripteur de tronçon ? */
+    if (lg_nom >= LG_TRONCON && memchr(nom, '\0', lg_nom) == nom + lg_nom - LG_TRONCON) {
+        lg_nom -= LG_TRONCON;
+        param->taille_fichier = lire_u64(nom + lg_nom + 1);
+        param->decalage = lire_u64(nom + lg_nom + 9);
+        if (param->taille_fichier == 0 || param->decalage > param->taille_fichier)
+            return 0;
+    }
+    if (lg_nom > LG_NOM_MAX)
+        return 0;
+    param->fenetre = paquet->info[0];
+    param->controle = paquet->info[1];
+    param->taille_info = paquet->info[2] | (paquet->info[3] << 8);
+    memcpy(param->nom, nom, lg_nom);
+    param->nom[lg_nom] = '\0';
+    /* nom tronqué par un '\0' : paramètres invalides */
+    return (int)strlen(param->nom) == lg_nom;
+}
+
+/* Identifiant aléatoire : deux émetteurs lancés au même instant
+ * ne doivent pas tirer le même (pas de rand() initialisé par l'heure) */
+uint32_t nouvel_id_connexion() {
+
+    uint32_t id = 0;
+
+    while (id == 0) {
+        if (getrandom(&id, sizeof(id), 0) != sizeof(id))
+            id = (uint32_t)horloge_us() ^ ((uint32_t)getpid() << 16);
+    }
+    return id;
+}
@@ -1,9 +1,15 @@
 #ifndef __COUCHE_TRANSPORT_H__
 #define __COUCHE_TRANSPORT_H__
 
-#include <stdint.h> /* uint8_t */
+#include <stdint.h> /* uint8_t, uint16_t, uint32_t */
 
-#define MAX_INFO 124
+/* Capacité du champ info : un datagramme UDP complet (65507 octets)
+ * moins l'en-tête du paquet. La taille effectivement utilisée par
+ * l'application est fixée par TAILLE_INFO dans config.txt (124 octets
+ * par défaut, ~1400 pour rester sous la MTU d'Ethernet, jusqu'à
+ * MAX_INFO en boucle locale). */
+#define MAX_INFO 65495
+#define TAILLE_INFO_DEFAUT 124
 
 /*************************
  * Structure d'un paquet *
@@ -12,8 +18,9 @@
 typedef struct paquet_s {
     uint8_t type;         /* type de paquet, cf. ci-dessous */
     uint8_t num_seq;      /* numéro de séquence */
-    uint8_t lg_info;      /* longueur du champ info */
-    uint8_t somme_ctrl;   /* somme de contrôle */
+    uint16_t lg_info;     /* longueur du champ info */
+    uint32_t id_con;      /* identifiant de connexion (mode connecté) */
+    uint32_t somme_ctrl;  /* somme de contrôle (CRC32C) */
     unsigned char info[MAX_INFO];  /* données utiles du paquet */
 } paquet_t;
 
@@ -33,6 +40,36 @@ typedef struct paquet_s {
 /* Capacite de numerotation pour l'anticipation */
 #define SEQ_NUM_SIZE 16
 
+/* ************************************************* */
+/* Estimation adaptative du RTO (Jacobson / Karels)  */
+/* ************************************************* */
+
+#define RTO_INITIAL 100000   /* RTO avant la première mesure (us) */
+#define RTO_MIN       1000   /* borne inférieure du RTO (us) */
+#define RTO_MAX    2000000   /* borne supérieure du RTO, backoff compris (us) */
+
+typedef struct rto_s {
+    long srtt;     /* RTT lissé (us), 0 tant qu'aucune mesure */
+    long rttvar;   /* variation du RTT (us) */
+    long rto;      /* temporisation de retransmission courante (us) */
+    long long date_envoi[SEQ_NUM_SIZE]; /* date de première émission (us) */
+    uint8_t retransmis[SEQ_NUM_SIZE];   /* paquet réémis : pas de mesure (Karn) */
+} rto_t;
+
+/* Initialisation de l'estimateur (une instance par connexion) */
+void rto_init(rto_t *e);
+
+/* A appeler à chaque émission du paquet num_seq :
+ * retransmission = 0 pour une première émission, 1 sinon */
+void rto_emission(rto_t *e, int num_seq, int retransmission);
+
+/* A appeler à l'acquittement du paquet num_seq : prend une mesure de RTT
+ * si le paquet n'a pas été réémis (algorithme de Karn) et annule le backoff */
+void rto_acquittement(rto_t *e, int num_seq);
+
+/* Doublement du RTO après expiration d'un temporisateur */
+void rto_backoff(rto_t *e);
+
 /* ************************************** */
 /* Fonctions utilitaires couche transport */
 /* ************************************** */
@@ -42,7 +79,97 @@ typedef struct paquet_s {
 *--------------------------------------*/
 int dans_fenetre(unsigned int inf, unsigned int pointeur, int taille);
 
-uint8_t generer_controle(paquet_t);
-uint8_t verifier_controle(paquet_t);
+/*-----------------------------------------------------------*
+* Nombre de paquets émis et non acquittés entre inf et sup   *
+* (sup exclu), modulo SEQ_NUM_SIZE                          *
+*-----------------------------------------------------------*/
+int en_vol(int inf, int sup);
+
+/*-----------------------------------------------------------*
+* Somme de contrôle des lg_info octets de info puis de       *
+* l'en-tête (type, num_seq, lg_info, id_con) : CRC32C par    *
+* défaut, ou type négocié en mode connecté                   *
+* (cf. choisir_controle)                                     *
+*-----------------------------------------------------------*/
+uint32_t generer_controle(const paquet_t *paquet);
+uint8_t verifier_controle(const paquet_t *paquet);
+
+/*-----------------------------------------------------------*
+* Change type et num_seq d'un paquet dont somme_ctrl est à   *
+* jour, et met à jour somme_ctrl sans relire info            *
+* (coût constant, quel que soit lg_info)                     *
+*-----------------------------------------------------------*/
+void modifier_entete(paquet_t *paquet, uint8_t type, uint8_t num_seq);
+
 int inc(int num, int mod);
+
+/* ************************************************* */
+/* Acquittements sélectifs (SACK, Selective Repeat)  */
+/* ************************************************* */
+
+/* Le champ info d'un ACK porte le prochain numéro attendu (acquittement
+ * cumulatif, 1 octet) puis un masque de 16 bits (poids faible en tête) :
+ * bit i = paquet cumul + 1 + i reçu hors séquence. Un ACK sans info
+ * n'acquitte que num_seq. */
+#define LG_SACK 3
+
+/* Paquet en vol considéré perdu quand SEUIL_SACK paquets émis après
+ * lui sont acquittés (cf. RFC 6675) */
+#define SEUIL_SACK 3
+
+void ecrire_sack(paquet_t *ack, int cumul, uint16_t masque);
+
+/* Marque dans acquitte[] les paquets en vol (de inf à sup exclu) que
+ * le SACK de ack couvre et qui ne l'étaient pas encore, et les range
+ * dans nouveaux[]. Renvoie leur nombre (0 si ack n'a pas de SACK). */
+int lire_sack(const paquet_t *ack, int inf, int sup, int acquitte[], int nouveaux[]);
+
+/* Paquets en vol non acquittés suivis d'au moins SEUIL_SACK paquets
+ * acquittés (trous à réémettre sans attendre le temporisateur), rangés
+ * dans trous[]. Renvoie leur nombre. */
+int trous_sack(int inf, int sup, const int acquitte[], int trous[]);
+
+/* ************************************************* */
+/* Mode connecté : paramètres négociés à l'ouverture */
+/* ************************************************* */
+
+/* Types de somme de contrôle (masque de bits) */
+#define CTRL_CRC32C   0x01  /* CRC32C, 32 bits (défaut) */
+#define CTRL_INTERNET 0x02  /* somme de l'Internet (RFC 1071), 16 bits */
+#define CTRL_MATERIEL 0x80  /* indication : CRC32C calculé par le processeur */
+
+/* Longueur maximale du nom de fichier transmis à l'ouverture */
+#define LG_NOM_MAX 255
+
+typedef struct parametres_s {
+    int fenetre;     /* taille de fenêtre */
+    int taille_info; /* charge utile maximale (octets) */
+    int controle;    /* types de somme de contrôle (CTRL_*) */
+    char nom[LG_NOM_MAX + 1]; /* nom du fichier reçu ("" : FICHIER_OUT) */
+    /* transfert par tronçons (un par connexion) : taille du fichier
+     * complet et position du tronçon (taille_fichier 0 : fichier entier) */
+    uint64_t taille_fichier;
+    uint64_t decalage;
+} parametres_t;
+
+/* Type de somme de contrôle des paquets DATA, ACK et NACK
+ * (les paquets CON_* utilisent toujours CTRL_CRC32C) */
+void choisir_controle(int type);
+
+/* Types supportés localement, CTRL_MATERIEL compris */
+int controles_supportes();
+
+/* Type le plus rapide commun aux deux masques (0 si aucun) :
+ * CRC32C s'il est calculé par le processeur des deux côtés,
+ * somme de l'Internet sinon */
+int negocier_controle(int local, int distant);
+
+/* Codage des paramètres dans le champ info d'un CON_REQ / CON_ACCEPT */
+void ecrire_parametres(paquet_t *paquet, const parametres_t *param);
+
+/* Lecture des paramètres, renvoie 0 si le champ info n'en contient pas */
+int lire_parametres(const paquet_t *paquet, parametres_t *param);
+
+/* Identifiant de connexion choisi par l'émetteur (non nul, aléatoire) */
+uint32_t nouvel_id_connexion();
 #endif
@@ -0,0 +1,121 @@
+/*************************************************************
+* CRC32C (Castagnoli, polynôme réfléchi 0x82F63B78)          *
+*                                                            *
+* Distance de Hamming 6 jusqu'à 5243 bits de message : toute *
+* erreur de 5 bits au plus est détectée sur un paquet de     *
+* 124 octets, quelle que soit sa répartition.                *
+**************************************************************/
+
+#include <string.h> /* memcpy */
+#include "crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h> /* _mm_crc32_* */
+#define CRC32C_SSE42
+#endif
+
+#define POLY 0x82F63B78
+
+/* table[k][b] : CRC de l'octet b suivi de k octets nuls */
+static uint32_t table[8][256];
+
+static uint32_t crc32c_init(uint32_t crc, const void *buf, size_t len);
+
+/* implémentation retenue, résolue au premier appel */
+static uint32_t (*crc32c_impl)(uint32_t, const void *, size_t) = crc32c_init;
+
+/* ------------------------------------------------------------- */
+/* Repli portable : 8 octets par itération, 8 lectures de table  */
+/* ------------------------------------------------------------- */
+static uint32_t crc32c_slicing8(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+              table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^
+              table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--)
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CRC32C_SSE42
+/* ------------------------------------------------------------- */
+/* Instruction crc32 (SSE4.2) : 8 octets par instruction         */
+/* ------------------------------------------------------------- */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len >= 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+    while (len--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+/* Premier appel : construction des tables et choix de l'implémentation */
+static uint32_t crc32c_init(uint32_t crc, const void *buf, size_t len)
+{
+    for (int b = 0; b < 256; b++) {
+        uint32_t c = b;
+        for (int i = 0; i < 8; i++)
+            c = (c >> 1) ^ (POLY & -(c & 1));
+        table[0][b] = c;
+    }
+    for (int b = 0; b < 256; b++)
+        for (int k = 1; k < 8; k++)
+            table[k][b] = (table[k-1][b] >> 8) ^ table[0][table[k-1][b] & 0xff];
+
+    crc32c_impl = crc32c_slicing8;
+#ifdef CRC32C_SSE42
+    if (__builtin_cpu_supports("sse4.2"))
+        crc32c_impl = crc32c_sse42;
+#endif
+    return crc32c_impl(crc, buf, len);
+}
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len)
+{
+    return ~crc32c_impl(~crc, buf, len);
+}
+
+int crc32c_materiel()
+{
+    if (crc32c_impl == crc32c_init)
+        crc32c(0, "", 0);
+#ifdef CRC32C_SSE42
+    return crc32c_impl == crc32c_sse42;
+#else
+    return 0;
+#endif
+}
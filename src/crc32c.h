@@ -0,0 +1,21 @@
+/*************************************************************
+* CRC32C (Castagnoli, polynôme réfléchi 0x82F63B78)          *
+*                                                            *
+* Instruction crc32 de SSE4.2 si le processeur la fournit,   *
+* table "slicing-by-8" sinon (choix fait au premier appel).  *
+**************************************************************/
+
+#ifndef __CRC32C_H__
+#define __CRC32C_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t */
+
+/* CRC32C de len octets à partir de buf. Les calculs s'enchaînent :
+ * crc32c(crc32c(0, a, la), b, lb) == CRC32C de a suivi de b. */
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
+/* 1 si le calcul utilise l'instruction crc32 du processeur */
+int crc32c_materiel();
+
+#endif
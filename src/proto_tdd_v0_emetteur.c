@@ -19,6 +19,7 @@ int main(int argc, char* argv[])
 {
     unsigned char message[MAX_INFO]; /* message de l'application */
     int taille_msg; /* taille du message */
+    int fin = 0; /* message de fin (vide) émis */
     paquet_t paquet; /* paquet utilisé par le protocole */
 
     init_reseau(EMISSION);
@@ -29,8 +30,9 @@ int main(int argc, char* argv[])
     /* lecture de donnees provenant de la couche application */
     de_application(message, &taille_msg);
 
-    /* tant que l'émetteur a des données à envoyer */
-    while ( taille_msg != 0 ) {
+    /* tant que l'émetteur a des données à envoyer, message vide de
+     * fin de fichier compris */
+    while ( !fin ) {
 
         /* construction paquet */
         for (int i=0; i<taille_msg; i++) {
@@ -38,12 +40,15 @@ int main(int argc, char* argv[])
         }
         paquet.lg_info = taille_msg;
         paquet.type = DATA;
+        paquet.id_con = 0; /* mode non connecté */
 
         /* remise à la couche reseau */
         vers_reseau(&paquet);
 
         /* lecture des donnees suivantes de la couche application */
-        de_application(message, &taille_msg);
+        fin = (taille_msg == 0);
+        if ( !fin )
+            de_application(message, &taille_msg);
     }
 
     printf("[TRP] Fin execution protocole transfert de donnees (TDD).\n");
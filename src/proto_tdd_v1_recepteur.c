@@ -27,6 +27,13 @@ int main(int argc, char* argv[])
     printf("[TRP] Initialisation reseau : OK.\n");
     printf("[TRP] Debut execution protocole transport.\n");
 
+    /* acquittement : seul son type (ACK/NACK) change ensuite */
+    pack.type = ACK;
+    pack.id_con = 0; /* mode non connecté */
+    pack.num_seq = 0;
+    pack.lg_info = 0;
+    pack.somme_ctrl = generer_controle(&pack);
+
     /* tant que le récepteur reçoit des données */
     while ( !fin ) {
 
@@ -34,14 +41,14 @@ int main(int argc, char* argv[])
         de_reseau(&paquet);
 
 
-        pack.type = NACK;
+        modifier_entete(&pack, NACK, 0);
 
-        while(!verifier_controle(paquet)){
+        while(!verifier_controle(&paquet)){
             vers_reseau(&pack);
             de_reseau(&paquet);
         }
 
-        pack.type = ACK;
+        modifier_entete(&pack, ACK, 0);
         vers_reseau(&pack);
         
 
@@ -1,8 +1,9 @@
 /*************************************************************
-* proto_tdd_v0 -  émetteur                                   *
-* TRANSFERT DE DONNEES  v0                                   *
+* proto_tdd_v2 -  émetteur                                   *
+* TRANSFERT DE DONNEES  v2                                   *
 *                                                            *
-* Protocole sans contrôle de flux, sans reprise sur erreurs  *
+* Protocole "Stop-and-Wait" à bit alterné : réémission sur   *
+* temporisateur, ou aussitôt sur NACK (paquet reçu erroné)   *
 *                                                            *
 * E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
 **************************************************************/
@@ -19,8 +20,11 @@ int main(int argc, char* argv[])
 {
     unsigned char message[MAX_INFO]; /* message de l'application */
     int taille_msg; /* taille du message */
+    int fin = 0; /* message de fin (vide) émis */
     int prochain_paquet = 0;
     int evt; // evenement
+    int acquitte; /* paquet courant acquitté */
+    rto_t rto; /* estimation adaptative du temporisateur */
 
     paquet_t paquet; /* paquet utilisé par le protocole */
     paquet_t pack; 
@@ -30,6 +34,7 @@ int main(int argc, char* argv[])
 
 
     init_reseau(EMISSION);
+    rto_init(&rto);
 
     printf("[TRP] Initialisation reseau : OK.\n");
     printf("[TRP] Debut execution protocole transport.\n");
@@ -37,8 +42,9 @@ int main(int argc, char* argv[])
     /* lecture de donnees provenant de la couche application */
     de_application(message, &taille_msg);
 
-    /* tant que l'émetteur a des données à envoyer */
-    while ( taille_msg != 0 ) {
+    /* tant que l'émetteur a des données à envoyer, message vide de
+     * fin de fichier compris */
+    while ( !fin ) {
 
         /* construction paquet */
         for (int i=0; i<taille_msg; i++) {
@@ -46,27 +52,53 @@ int main(int argc, char* argv[])
         }
         paquet.lg_info = taille_msg;  
         paquet.type = DATA;
+        paquet.id_con = 0; /* mode non connecté */
         paquet.num_seq = prochain_paquet;
-        paquet.somme_ctrl = generer_controle(paquet);
+        paquet.somme_ctrl = generer_controle(&paquet);
 
         /* remise à la couche reseau */
         vers_reseau(&paquet);
+        rto_emission(&rto, prochain_paquet, 0);
 
-        depart_temporisateur(100);
-        evt = attendre();
+        depart_temporisateur_num_us(1, rto.rto);
 
-        while (evt != PAQUET_RECU){
-            vers_reseau(&paquet);
-            depart_temporisateur(100);
+        /* attente de l'acquittement du paquet */
+        acquitte = 0;
+        while ( !acquitte ) {
             evt = attendre();
+            if (evt != PAQUET_RECU) {
+                /* timeout : réémission */
+                rto_backoff(&rto);
+                vers_reseau(&paquet);
+                rto_emission(&rto, prochain_paquet, 1);
+                depart_temporisateur_num_us(1, rto.rto);
+                continue;
+            }
+            de_reseau(&pack);
+            /* acquittement erroné : ignoré */
+            if ( !verifier_controle(&pack) )
+                continue;
+            if (pack.type == NACK) {
+                /* réémission rapide, sans attendre le temporisateur :
+                 * il repart du RTO courant (pas de backoff) */
+                arret_temporisateur();
+                vers_reseau(&paquet);
+                rto_emission(&rto, prochain_paquet, 1);
+                depart_temporisateur_num_us(1, rto.rto);
+            }
+            /* un acquittement du paquet précédent (doublon) est ignoré */
+            else if (pack.type == ACK && pack.num_seq == prochain_paquet)
+                acquitte = 1;
         }
 
-        de_reseau(&pack);
         arret_temporisateur();
+        rto_acquittement(&rto, prochain_paquet);
         prochain_paquet = inc(prochain_paquet, 2);
 
         /* lecture des donnees suivantes de la couche application */
-        de_application(message, &taille_msg);
+        fin = (taille_msg == 0);
+        if ( !fin )
+            de_application(message, &taille_msg);
     }
 
     printf("[TRP] Fin execution protocole transfert de donnees (TDD).\n");
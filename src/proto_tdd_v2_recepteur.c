@@ -1,8 +1,10 @@
 /*************************************************************
-* proto_tdd_v0 -  récepteur                                  *
-* TRANSFERT DE DONNEES  v0                                   *
+* proto_tdd_v2 -  récepteur                                  *
+* TRANSFERT DE DONNEES  v2                                   *
 *                                                            *
-* Protocole sans contrôle de flux, sans reprise sur erreurs  *
+* Protocole "Stop-and-Wait" à bit alterné : un paquet erroné *
+* est signalé par un NACK, un doublon est acquitté sans être *
+* remis à l'application                                      *
 *                                                            *
 * E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
 **************************************************************/
@@ -12,6 +14,10 @@
 #include "couche_transport.h"
 #include "services_reseau.h"
 
+/* durée de silence (ms) avant de terminer : permet de réacquitter
+ * le dernier paquet si son ACK a été perdu */
+#define TEMPO_FIN 500
+
 /* =============================== */
 /* Programme principal - récepteur */
 /* =============================== */
@@ -21,29 +27,39 @@ int main(int argc, char* argv[])
     paquet_t paquet; /* paquet utilisé par le protocole */
     paquet_t pack;
     int fin = 0; /* condition d'arrêt */
+    int paquet_attendu = 0; /* bit alterné du prochain paquet */
 
     init_reseau(RECEPTION);
 
     printf("[TRP] Initialisation reseau : OK.\n");
     printf("[TRP] Debut execution protocole transport.\n");
 
+    /* acquittement : seul son type (ACK/NACK) change ensuite */
+    pack.type = ACK;
+    pack.id_con = 0; /* mode non connecté */
+    pack.num_seq = 0;
+    pack.lg_info = 0;
+    pack.somme_ctrl = generer_controle(&pack);
+
     /* tant que le récepteur reçoit des données */
     while ( !fin ) {
 
         // attendre(); /* optionnel ici car de_reseau() fct bloquante */
         de_reseau(&paquet);
 
-
-        pack.type = NACK;
-
-        while(!verifier_controle(paquet)){
-            // vers_reseau(&pack);
-            de_reseau(&paquet);
+        if ( !verifier_controle(&paquet) ) {
+            /* paquet erroné : l'émetteur le réémet aussitôt */
+            modifier_entete(&pack, NACK, 0);
+            vers_reseau(&pack);
+            continue;
         }
 
-        pack.type = ACK;
+        /* acquittement, y compris d'un doublon (ACK perdu) */
+        modifier_entete(&pack, ACK, paquet.num_seq);
         vers_reseau(&pack);
-        
+        if (paquet.num_seq != paquet_attendu)
+            continue;
+        paquet_attendu = inc(paquet_attendu, 2);
 
         /* extraction des donnees du paquet recu */
         for (int i=0; i<paquet.lg_info; i++) {
@@ -53,6 +69,18 @@ int main(int argc, char* argv[])
         fin = vers_application(message, paquet.lg_info);
     }
 
+    /* réacquittement des retransmissions tant que l'émetteur en envoie */
+    depart_temporisateur(TEMPO_FIN);
+    while ( attendre() == PAQUET_RECU ) {
+        de_reseau(&paquet);
+        if ( verifier_controle(&paquet) ) {
+            modifier_entete(&pack, ACK, paquet.num_seq);
+            vers_reseau(&pack);
+            arret_temporisateur();
+            depart_temporisateur(TEMPO_FIN);
+        }
+    }
+
     printf("[TRP] Fin execution protocole transport.\n");
     return 0;
 }
@@ -0,0 +1,139 @@
+/*************************************************************
+* proto_tdd_v3.1 -  émetteur                                 *
+* TRANSFERT DE DONNEES  v3.1                                 *
+*                                                            *
+* Protocole "Go-Back-N" : anticipation avec fenêtre          *
+* d'émission, acquittements cumulatifs et reprise sur        *
+* temporisateur de toute la fenêtre.                         *
+*                                                            *
+* Usage : ./bin/emetteur [taille_fenetre]                    *
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "application.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+#define FENETRE_DEFAUT 8   /* taille de fenêtre si non précisée */
+
+/* =============================== */
+/* Programme principal - émetteur  */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    const unsigned char *message; /* données de l'application (sans copie) */
+    int taille_msg; /* taille du message */
+    int fin = 0; /* message de fin (vide) placé dans la fenêtre */
+    int taille_fenetre = FENETRE_DEFAUT;
+    int borne_inf = 0; /* plus ancien paquet non acquitté */
+    int curseur = 0;   /* prochain numéro de séquence à émettre */
+    int evt; /* évènement retourné par attendre() */
+    int nb; /* nombre de paquets d'un lot */
+    rto_t rto; /* estimation adaptative du temporisateur */
+
+    static paquet_t tab_p[SEQ_NUM_SIZE]; /* paquets émis en attente d'acquittement */
+    static paquet_t tab_ack[SEQ_NUM_SIZE]; /* acquittements reçus en un lot */
+    paquet_t *lot[SEQ_NUM_SIZE]; /* paquets remis ensemble à la couche réseau */
+
+    if (argc > 1) {
+        taille_fenetre = atoi(argv[1]);
+        /* Go-Back-N : la fenêtre doit rester strictement inférieure
+         * à la capacité de numérotation */
+        if (taille_fenetre < 1 || taille_fenetre > SEQ_NUM_SIZE - 1) {
+            printf("[TRP] Taille de fenetre invalide (1 a %d).\n", SEQ_NUM_SIZE - 1);
+            exit(1);
+        }
+    }
+
+    init_reseau(EMISSION);
+    rto_init(&rto);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+    printf("[TRP] Debut execution protocole transport (fenetre %d).\n", taille_fenetre);
+
+    /* lecture de donnees provenant de la couche application */
+    message = de_application_ptr(&taille_msg);
+
+    /* tant qu'il reste des données à envoyer (message vide de fin de
+     * fichier compris) ou des paquets non acquittés */
+    while ( !fin || borne_inf != curseur ) {
+
+        if ( !fin && dans_fenetre(borne_inf, curseur, taille_fenetre) ) {
+
+            /* construction de tous les paquets que la fenêtre autorise */
+            int premier = curseur;
+            nb = 0;
+            while ( !fin && dans_fenetre(borne_inf, curseur, taille_fenetre) ) {
+                memcpy(tab_p[curseur].info, message, taille_msg);
+                tab_p[curseur].lg_info = taille_msg;
+                tab_p[curseur].type = DATA;
+                tab_p[curseur].id_con = 0;
+                tab_p[curseur].num_seq = curseur;
+                tab_p[curseur].somme_ctrl = generer_controle(&tab_p[curseur]);
+                lot[nb++] = &tab_p[curseur];
+
+                curseur = inc(curseur, SEQ_NUM_SIZE);
+
+                /* lecture des donnees suivantes de la couche application */
+                fin = (taille_msg == 0);
+                if ( !fin )
+                    message = de_application_ptr(&taille_msg);
+            }
+
+            /* remise du lot à la couche reseau */
+            vers_reseau_lot(lot, nb);
+            for (int i = premier; i != curseur; i = inc(i, SEQ_NUM_SIZE))
+                rto_emission(&rto, i, 0);
+
+            /* un seul temporisateur, associé au plus ancien paquet */
+            if (borne_inf == premier)
+                depart_temporisateur_num_us(1, rto.rto);
+        }
+        else {
+            evt = attendre();
+
+            if (evt == PAQUET_RECU) {
+                /* traitement de tous les acquittements disponibles */
+                int avance = 0;
+                nb = de_reseau_lot(tab_ack, SEQ_NUM_SIZE);
+                for (int k = 0; k < nb; k++) {
+                    /* acquittement cumulatif valide et portant sur un paquet émis ? */
+                    if ( verifier_controle(&tab_ack[k]) && tab_ack[k].type == ACK &&
+                         dans_fenetre(borne_inf, tab_ack[k].num_seq, en_vol(borne_inf, curseur)) ) {
+
+                        rto_acquittement(&rto, tab_ack[k].num_seq);
+                        borne_inf = inc(tab_ack[k].num_seq, SEQ_NUM_SIZE);
+                        avance = 1;
+                    }
+                }
+                if (avance) {
+                    arret_temporisateur_num(1);
+                    if (borne_inf != curseur)
+                        depart_temporisateur_num_us(1, rto.rto);
+                }
+            }
+            else {
+                /* timeout : réémission de toute la fenêtre en un lot */
+                rto_backoff(&rto);
+                depart_temporisateur_num_us(1, rto.rto);
+                nb = 0;
+                for (int i = borne_inf; i != curseur; i = inc(i, SEQ_NUM_SIZE)) {
+                    lot[nb++] = &tab_p[i];
+                    rto_emission(&rto, i, 1);
+                }
+                vers_reseau_lot(lot, nb);
+            }
+        }
+        /* paquets en vol (télémétrie, cf. PERIODE_CALCUL_DEBIT) */
+        perf_fenetre(en_vol(borne_inf, curseur));
+        /* débit d'émission (RYTHME_EMISSION auto) */
+        rythme_emission(taille_fenetre, rto.srtt);
+    }
+
+    printf("[TRP] Fin execution protocole transfert de donnees (TDD).\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*************************************************************
+* proto_tdd_v3 -  récepteur                                  *
+* TRANSFERT DE DONNEES  v3                                   *
+*                                                            *
+* Protocole "Go-Back-N" : le récepteur n'accepte que le      *
+* paquet attendu et acquitte de manière cumulative le        *
+* dernier paquet reçu en séquence.                           *
+* Avec ACK_DIFFERE n (config.txt), un seul acquittement pour *
+* n paquets reçus en séquence, ou au plus DELAI_ACK_US après *
+* le premier ; un paquet hors séquence est acquitté aussitôt.*
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include "application.h"
+#include "config.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+/* durée de silence (ms) avant de terminer : permet de réacquitter
+ * les derniers paquets si le dernier ACK a été perdu */
+#define TEMPO_FIN 500
+
+#define TEMPO_ACK 0 /* temporisateur des acquittements différés */
+
+/* =============================== */
+/* Programme principal - récepteur */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    unsigned char message[MAX_INFO]; /* message pour l'application */
+    paquet_t paquet; /* paquet utilisé par le protocole */
+    paquet_t pack; /* acquittement */
+    int paquet_attendu = 0; /* prochain numéro de séquence attendu */
+    int fin = 0; /* condition d'arrêt */
+    int nb, nb_ack; /* nombre de paquets reçus / d'acquittements d'un lot */
+    int ack_differe = conf_ack_every(); /* paquets par acquittement */
+    long delai_ack = conf_ack_delay_us();
+    int non_acquittes = 0; /* paquets remis depuis le dernier acquittement */
+    int tempo_ack = 0;     /* temporisateur TEMPO_ACK en cours */
+
+    static paquet_t tab_p[SEQ_NUM_SIZE];   /* paquets reçus en un lot */
+    static paquet_t tab_ack[SEQ_NUM_SIZE]; /* acquittements émis en un lot */
+    paquet_t *lot[SEQ_NUM_SIZE];
+
+    init_reseau(RECEPTION);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+    printf("[TRP] Debut execution protocole transport.\n");
+
+    /* aucun paquet reçu : l'acquittement "précédent" est hors fenêtre */
+    pack.type = ACK;
+    pack.id_con = 0; /* mode non connecté */
+    pack.lg_info = 0;
+    pack.num_seq = SEQ_NUM_SIZE - 1;
+    pack.somme_ctrl = generer_controle(&pack);
+
+    /* tant que le récepteur reçoit des données */
+    while ( !fin ) {
+
+        /* acquittement différé : délai écoulé */
+        if ( ack_differe > 1 && attendre() != PAQUET_RECU ) {
+            vers_reseau(&pack);
+            non_acquittes = 0;
+            tempo_ack = 0;
+            continue;
+        }
+
+        /* tous les paquets disponibles sont traités en un lot */
+        nb = de_reseau_lot(tab_p, SEQ_NUM_SIZE);
+        nb_ack = 0;
+
+        for (int k = 0; k < nb && !fin; k++) {
+
+            /* paquet erroné : ignoré, l'émetteur réémettra sur timeout */
+            if ( !verifier_controle(&tab_p[k]) )
+                continue;
+
+            if (tab_p[k].num_seq == paquet_attendu) {
+                /* extraction des donnees du paquet recu */
+                for (int i=0; i<tab_p[k].lg_info; i++) {
+                    message[i] = tab_p[k].info[i];
+                }
+                /* remise des données à la couche application */
+                fin = vers_application(message, tab_p[k].lg_info);
+
+                modifier_entete(&pack, ACK, paquet_attendu);
+                paquet_attendu = inc(paquet_attendu, SEQ_NUM_SIZE);
+
+                /* un acquittement pour ack_differe paquets (le dernier
+                 * paquet du fichier est acquitté aussitôt) */
+                if (++non_acquittes < ack_differe && !fin)
+                    continue;
+            }
+
+            /* acquittement cumulatif (réacquittement immédiat si hors
+             * séquence, qui couvre aussi les paquets en attente) */
+            non_acquittes = 0;
+            tab_ack[nb_ack].type = ACK;
+            tab_ack[nb_ack].lg_info = 0;
+            tab_ack[nb_ack].id_con = pack.id_con;
+            tab_ack[nb_ack].num_seq = pack.num_seq;
+            tab_ack[nb_ack].somme_ctrl = pack.somme_ctrl;
+            lot[nb_ack] = &tab_ack[nb_ack];
+            nb_ack++;
+        }
+        vers_reseau_lot(lot, nb_ack);
+
+        /* paquets en attente d'acquittement : au plus delai_ack */
+        if (non_acquittes == 0 && tempo_ack) {
+            arret_temporisateur_num(TEMPO_ACK);
+            tempo_ack = 0;
+        }
+        else if (non_acquittes > 0 && !tempo_ack) {
+            depart_temporisateur_num_us(TEMPO_ACK, delai_ack);
+            tempo_ack = 1;
+        }
+    }
+
+    /* réacquittement des retransmissions tant que l'émetteur en envoie */
+    depart_temporisateur(TEMPO_FIN);
+    while ( attendre() == PAQUET_RECU ) {
+        de_reseau(&paquet);
+        if ( verifier_controle(&paquet) ) {
+            vers_reseau(&pack);
+            arret_temporisateur();
+            depart_temporisateur(TEMPO_FIN);
+        }
+    }
+
+    printf("[TRP] Fin execution protocole transport.\n");
+    return 0;
+}
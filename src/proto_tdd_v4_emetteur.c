@@ -0,0 +1,162 @@
+/*************************************************************
+* proto_tdd_v4 -  émetteur                                   *
+* TRANSFERT DE DONNEES  v4                                   *
+*                                                            *
+* Protocole "Selective Repeat" : anticipation avec fenêtre   *
+* d'émission, acquittements individuels et un                *
+* temporisateur par paquet en vol (seul le paquet dont le    *
+* temporisateur expire est réémis).                          *
+*                                                            *
+* Usage : ./bin/emetteur [taille_fenetre]                    *
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "application.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+#define FENETRE_DEFAUT 8   /* taille de fenêtre si non précisée */
+
+/* =============================== */
+/* Programme principal - émetteur  */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    const unsigned char *message; /* données de l'application (sans copie) */
+    int taille_msg; /* taille du message */
+    int fin = 0; /* message de fin (vide) placé dans la fenêtre */
+    int taille_fenetre = FENETRE_DEFAUT;
+    int borne_inf = 0; /* plus ancien paquet non acquitté */
+    int curseur = 0;   /* prochain numéro de séquence à émettre */
+    int evt; /* évènement retourné par attendre() */
+    int nb; /* nombre de paquets d'un lot */
+    rto_t rto; /* estimation adaptative des temporisateurs */
+
+    static paquet_t tab_p[SEQ_NUM_SIZE]; /* paquets émis en attente d'acquittement */
+    int acquitte[SEQ_NUM_SIZE];   /* paquets de la fenêtre déjà acquittés */
+    int reemis_sack[SEQ_NUM_SIZE]; /* trous déjà réémis sur SACK */
+    int liste[SEQ_NUM_SIZE];      /* paquets acquittés ou trous d'un SACK */
+    static paquet_t tab_ack[SEQ_NUM_SIZE]; /* acquittements reçus en un lot */
+    paquet_t *lot[SEQ_NUM_SIZE]; /* paquets remis ensemble à la couche réseau */
+
+    if (argc > 1) {
+        taille_fenetre = atoi(argv[1]);
+        /* Selective Repeat : la fenêtre ne doit pas dépasser
+         * la moitié de la capacité de numérotation */
+        if (taille_fenetre < 1 || taille_fenetre > SEQ_NUM_SIZE / 2) {
+            printf("[TRP] Taille de fenetre invalide (1 a %d).\n", SEQ_NUM_SIZE / 2);
+            exit(1);
+        }
+    }
+
+    init_reseau(EMISSION);
+    rto_init(&rto);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+    printf("[TRP] Debut execution protocole transport (fenetre %d).\n", taille_fenetre);
+
+    /* lecture de donnees provenant de la couche application */
+    message = de_application_ptr(&taille_msg);
+
+    /* tant qu'il reste des données à envoyer (message vide de fin de
+     * fichier compris) ou des paquets non acquittés */
+    while ( !fin || borne_inf != curseur ) {
+
+        if ( !fin && dans_fenetre(borne_inf, curseur, taille_fenetre) ) {
+
+            /* construction de tous les paquets que la fenêtre autorise */
+            int premier = curseur;
+            nb = 0;
+            while ( !fin && dans_fenetre(borne_inf, curseur, taille_fenetre) ) {
+                memcpy(tab_p[curseur].info, message, taille_msg);
+                tab_p[curseur].lg_info = taille_msg;
+                tab_p[curseur].type = DATA;
+                tab_p[curseur].id_con = 0;
+                tab_p[curseur].num_seq = curseur;
+                tab_p[curseur].somme_ctrl = generer_controle(&tab_p[curseur]);
+                acquitte[curseur] = 0;
+                reemis_sack[curseur] = 0;
+                lot[nb++] = &tab_p[curseur];
+
+                curseur = inc(curseur, SEQ_NUM_SIZE);
+
+                /* lecture des donnees suivantes de la couche application */
+                fin = (taille_msg == 0);
+                if ( !fin )
+                    message = de_application_ptr(&taille_msg);
+            }
+
+            /* remise du lot à la couche reseau, chaque temporisateur
+             * porte le numéro de séquence de son paquet */
+            vers_reseau_lot(lot, nb);
+            for (int i = premier; i != curseur; i = inc(i, SEQ_NUM_SIZE)) {
+                rto_emission(&rto, i, 0);
+                depart_temporisateur_num_us(i, rto.rto);
+            }
+        }
+        else {
+            evt = attendre();
+
+            if (evt == PAQUET_RECU) {
+                /* traitement de tous les acquittements disponibles */
+                nb = de_reseau_lot(tab_ack, SEQ_NUM_SIZE);
+                for (int k = 0; k < nb; k++) {
+                    paquet_t *pack = &tab_ack[k];
+                    /* acquittement valide ? */
+                    if ( !verifier_controle(pack) || pack->type != ACK )
+                        continue;
+                    /* portant sur un paquet en vol ? */
+                    if ( dans_fenetre(borne_inf, pack->num_seq, en_vol(borne_inf, curseur)) &&
+                         !acquitte[pack->num_seq] ) {
+
+                        acquitte[pack->num_seq] = 1;
+                        arret_temporisateur_num(pack->num_seq);
+                        rto_acquittement(&rto, pack->num_seq);
+                    }
+                    /* SACK : paquets dont l'acquittement a été perdu
+                     * (pas de mesure de RTT, la date d'arrivée est inconnue) */
+                    int n = lire_sack(pack, borne_inf, curseur, acquitte, liste);
+                    for (int j = 0; j < n; j++)
+                        arret_temporisateur_num(liste[j]);
+                }
+
+                /* trous signalés par le SACK : réémission immédiate
+                 * (une seule fois, le temporisateur prend ensuite le relais) */
+                nb = trous_sack(borne_inf, curseur, acquitte, liste);
+                for (int j = 0; j < nb; j++) {
+                    int t = liste[j];
+                    if (reemis_sack[t])
+                        continue;
+                    reemis_sack[t] = 1;
+                    vers_reseau(&tab_p[t]);
+                    rto_emission(&rto, t, 1);
+                    /* le temporisateur du trou (en cours) repart du RTO courant */
+                    arret_temporisateur_num(t);
+                    depart_temporisateur_num_us(t, rto.rto);
+                }
+
+                /* glissement de la fenêtre sur les paquets acquittés */
+                while (borne_inf != curseur && acquitte[borne_inf])
+                    borne_inf = inc(borne_inf, SEQ_NUM_SIZE);
+            }
+            else {
+                /* timeout : réémission du seul paquet concerné */
+                rto_backoff(&rto);
+                vers_reseau(&tab_p[evt]);
+                rto_emission(&rto, evt, 1);
+                depart_temporisateur_num_us(evt, rto.rto);
+            }
+        }
+        /* paquets en vol (télémétrie, cf. PERIODE_CALCUL_DEBIT) */
+        perf_fenetre(en_vol(borne_inf, curseur));
+        /* débit d'émission (RYTHME_EMISSION auto) */
+        rythme_emission(taille_fenetre, rto.srtt);
+    }
+
+    printf("[TRP] Fin execution protocole transfert de donnees (TDD).\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*************************************************************
+* proto_tdd_v4 -  récepteur                                  *
+* TRANSFERT DE DONNEES  v4                                   *
+*                                                            *
+* Protocole "Selective Repeat" : le récepteur accepte tout   *
+* paquet de sa fenêtre de réception, le mémorise s'il est    *
+* hors séquence et remet les données dans l'ordre à la       *
+* couche application.                                        *
+*                                                            *
+* Usage : ./bin/recepteur [taille_fenetre]                   *
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "application.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+#define FENETRE_DEFAUT 8   /* taille de fenêtre si non précisée */
+
+/* durée de silence (ms) avant de terminer : permet de réacquitter
+ * les derniers paquets si le dernier ACK a été perdu */
+#define TEMPO_FIN 500
+
+/* =============================== */
+/* Programme principal - récepteur */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    unsigned char message[MAX_INFO]; /* message pour l'application */
+    paquet_t paquet; /* paquet utilisé par le protocole */
+    paquet_t pack; /* acquittement */
+    int taille_fenetre = FENETRE_DEFAUT;
+    int paquet_attendu = 0; /* borne inférieure de la fenêtre de réception */
+    int fin = 0; /* condition d'arrêt */
+    int nb, nb_ack; /* nombre de paquets reçus / d'acquittements d'un lot */
+    uint16_t masque; /* SACK : paquets de la fenêtre reçus hors séquence */
+
+    static paquet_t tampon[SEQ_NUM_SIZE]; /* paquets reçus hors séquence */
+    int recu[SEQ_NUM_SIZE] = { 0 };
+    static paquet_t tab_p[SEQ_NUM_SIZE];   /* paquets reçus en un lot */
+    static paquet_t tab_ack[SEQ_NUM_SIZE]; /* acquittements émis en un lot */
+    paquet_t *lot[SEQ_NUM_SIZE];
+
+    if (argc > 1) {
+        taille_fenetre = atoi(argv[1]);
+        if (taille_fenetre < 1 || taille_fenetre > SEQ_NUM_SIZE / 2) {
+            printf("[TRP] Taille de fenetre invalide (1 a %d).\n", SEQ_NUM_SIZE / 2);
+            exit(1);
+        }
+    }
+
+    init_reseau(RECEPTION);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+    printf("[TRP] Debut execution protocole transport (fenetre %d).\n", taille_fenetre);
+
+    pack.type = ACK;
+    pack.id_con = 0; /* mode non connecté */
+    pack.lg_info = 0;
+    pack.num_seq = 0;
+    pack.somme_ctrl = generer_controle(&pack);
+
+    /* tant que le récepteur reçoit des données */
+    while ( !fin ) {
+
+        /* tous les paquets disponibles sont traités en un lot */
+        nb = de_reseau_lot(tab_p, SEQ_NUM_SIZE);
+        nb_ack = 0;
+
+        for (int k = 0; k < nb && !fin; k++) {
+            paquet_t *p = &tab_p[k];
+
+            /* paquet erroné : ignoré, l'émetteur réémettra sur timeout */
+            if ( !verifier_controle(p) )
+                continue;
+
+            if ( dans_fenetre(paquet_attendu, p->num_seq, taille_fenetre) ) {
+                /* mémorisation (les doublons sont écrasés à l'identique) */
+                tampon[p->num_seq].lg_info = p->lg_info;
+                for (int i=0; i<p->lg_info; i++) {
+                    tampon[p->num_seq].info[i] = p->info[i];
+                }
+                recu[p->num_seq] = 1;
+
+                /* remise dans l'ordre des paquets consécutifs disponibles */
+                while ( !fin && recu[paquet_attendu] ) {
+                    for (int i=0; i<tampon[paquet_attendu].lg_info; i++) {
+                        message[i] = tampon[paquet_attendu].info[i];
+                    }
+                    fin = vers_application(message, tampon[paquet_attendu].lg_info);
+                    recu[paquet_attendu] = 0;
+                    paquet_attendu = inc(paquet_attendu, SEQ_NUM_SIZE);
+                }
+            }
+            else if ( !dans_fenetre((paquet_attendu - taille_fenetre + SEQ_NUM_SIZE) % SEQ_NUM_SIZE,
+                                    p->num_seq, taille_fenetre) ) {
+                /* ni dans la fenêtre, ni déjà remis : pas d'acquittement */
+                continue;
+            }
+
+            /* acquittement individuel (y compris des paquets déjà remis,
+             * dont l'acquittement a pu être perdu), avec le SACK de la
+             * fenêtre : couvre aussi les acquittements précédents perdus */
+            masque = 0;
+            for (int b = 0; b < taille_fenetre - 1; b++)
+                if (recu[(paquet_attendu + 1 + b) % SEQ_NUM_SIZE])
+                    masque |= 1 << b;
+            tab_ack[nb_ack].type = ACK;
+            tab_ack[nb_ack].num_seq = p->num_seq;
+            tab_ack[nb_ack].id_con = 0;
+            ecrire_sack(&tab_ack[nb_ack], paquet_attendu, masque);
+            tab_ack[nb_ack].somme_ctrl = generer_controle(&tab_ack[nb_ack]);
+            lot[nb_ack] = &tab_ack[nb_ack];
+            nb_ack++;
+        }
+        vers_reseau_lot(lot, nb_ack);
+    }
+
+    /* réacquittement des retransmissions tant que l'émetteur en envoie */
+    depart_temporisateur(TEMPO_FIN);
+    while ( attendre() == PAQUET_RECU ) {
+        de_reseau(&paquet);
+        if ( verifier_controle(&paquet) ) {
+            modifier_entete(&pack, ACK, paquet.num_seq);
+            vers_reseau(&pack);
+            arret_temporisateur();
+            depart_temporisateur(TEMPO_FIN);
+        }
+    }
+
+    printf("[TRP] Fin execution protocole transport.\n");
+    return 0;
+}
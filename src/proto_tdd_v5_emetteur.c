@@ -0,0 +1,338 @@
+/*************************************************************
+* proto_tdd_v5 -  émetteur                                   *
+* TRANSFERT DE DONNEES  v5 (mode connecté)                   *
+*                                                            *
+* Ouverture de connexion (CON_REQ / CON_ACCEPT) négociant la *
+* taille de fenêtre, la taille de charge utile et le type de *
+* somme de contrôle, transfert "Selective Repeat" (cf. v4),  *
+* puis fermeture (CON_CLOSE / CON_CLOSE_ACK). Les paquets de *
+* connexion perdus sont réémis sur temporisateur.            *
+* Les paquets en vol sont limités par la fenêtre de          *
+* congestion (CONTROLE_CONGESTION), sans dépasser la         *
+* fenêtre négociée.                                          *
+* Chaque paquet porte l'identifiant de la connexion, ce qui  *
+* permet à un même récepteur de servir plusieurs émetteurs.  *
+*                                                            *
+* Un gros fichier peut être découpé en nb_flux tronçons      *
+* contigus, émis en parallèle par autant de processus (un    *
+* flux, donc une connexion et une paire de ports, chacun).   *
+*                                                            *
+* Usage : ./bin/emetteur [taille_fenetre [fichier nom_recu   *
+*                        [nb_flux]]]                         *
+*   fichier : fichier à émettre (FICHIER_IN si "" ou absent) *
+*   nom_recu : nom du fichier créé par le récepteur, dans le *
+*              répertoire de son FICHIER_OUT                 *
+*   nb_flux : flux parallèles (1 par défaut), le récepteur   *
+*             doit être lancé avec le même nombre            *
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "application.h"
+#include "config.h"
+#include "controle_congestion.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+#define FENETRE_DEFAUT 8   /* taille de fenêtre proposée si non précisée */
+#define NB_ESSAIS_MAX 10   /* émissions d'un CON_REQ / CON_CLOSE avant abandon */
+#define TEMPO_CON 0        /* temporisateur des paquets de connexion (aucun
+                            * paquet de données n'est alors en vol) */
+#define NB_FLUX_MAX 16     /* flux parallèles d'un transfert */
+#define ALIGNEMENT 4096    /* bornes des tronçons (pages, blocs disque) */
+
+/*
+ * Emission d'un paquet de connexion (CON_REQ ou CON_CLOSE), réémis sur
+ * temporisateur jusqu'à réception d'une réponse de type type_reponse
+ * (ou CON_REFUSE). Renvoie 1 et la réponse, ou 0 après NB_ESSAIS_MAX
+ * émissions sans réponse.
+ */
+static int echange(paquet_t *paquet, int type_reponse, paquet_t *reponse, rto_t *rto)
+{
+    for (int essai = 0; essai < NB_ESSAIS_MAX; essai++) {
+        vers_reseau(paquet);
+        rto_emission(rto, 0, essai > 0);
+        depart_temporisateur_num_us(TEMPO_CON, rto->rto);
+
+        while ( attendre() == PAQUET_RECU ) {
+            de_reseau(reponse);
+            /* les acquittements de données en retard sont ignorés */
+            if ( verifier_controle(reponse) &&
+                 (reponse->type == type_reponse || reponse->type == CON_REFUSE) &&
+                 reponse->id_con == paquet->id_con ) {
+                arret_temporisateur_num(TEMPO_CON);
+                rto_acquittement(rto, 0);
+                return 1;
+            }
+        }
+        rto_backoff(rto);
+    }
+    return 0;
+}
+
+/*
+* Découpage du fichier en nb_flux tronçons contigus, aux bornes alignées
+* sur ALIGNEMENT octets, et création d'un processus par flux. Renvoie
+* le numéro de flux dans le processus fils (tronçon choisi, et décrit
+* dans *proposition) ; le processus père attend la fin de tous les flux
+* et termine.
+*/
+static int lancer_flux(int nb_flux, parametres_t *proposition)
+{
+    uint64_t taille = taille_fichier_emission();
+    uint64_t part = (taille / nb_flux + ALIGNEMENT - 1) / ALIGNEMENT * ALIGNEMENT;
+    int echecs = 0, statut;
+
+    if (taille == 0) {
+        printf("[TRP] Fichier vide : un seul flux.\n");
+        return 0;
+    }
+    for (int i = 0; i < nb_flux; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("[TRP] Problème création d'un flux !\n");
+            exit(1);
+        }
+        if (pid == 0) {
+            /* les derniers tronçons peuvent être vides */
+            uint64_t decalage = part * i < taille ? part * i : taille;
+            uint64_t fin = decalage + part < taille ? decalage + part : taille;
+            choisir_flux(i);
+            choisir_troncon_emission(decalage, fin - decalage);
+            proposition->taille_fichier = taille;
+            proposition->decalage = decalage;
+            return i;
+        }
+    }
+    while (wait(&statut) > 0)
+        if (!WIFEXITED(statut) || WEXITSTATUS(statut) != 0)
+            echecs++;
+    printf("[TRP] %d flux termines, %d en echec.\n", nb_flux, echecs);
+    exit(echecs > 0);
+}
+
+/* =============================== */
+/* Programme principal - émetteur  */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    const unsigned char *message; /* données de l'application (sans copie) */
+    int taille_msg; /* taille du message */
+    int fin = 0; /* toutes les données ont été placées dans la fenêtre */
+    int taille_fenetre = FENETRE_DEFAUT;
+    int nb_flux = 1; /* flux parallèles */
+    int borne_inf = 0; /* plus ancien paquet non acquitté */
+    int curseur = 0;   /* prochain numéro de séquence à émettre */
+    int evt; /* évènement retourné par attendre() */
+    int nb; /* nombre de paquets d'un lot */
+    rto_t rto; /* estimation adaptative des temporisateurs */
+    congestion_t cc; /* fenêtre de congestion */
+    int algo_cc = conf_congestion();
+    int fenetre; /* paquets en vol autorisés */
+    int nouveaux; /* paquets nouvellement acquittés par un lot d'ACK */
+    uint32_t id_con;
+    paquet_t con, reponse; /* paquets de connexion */
+    parametres_t proposition, accord;
+
+    static paquet_t tab_p[SEQ_NUM_SIZE]; /* paquets émis en attente d'acquittement */
+    int acquitte[SEQ_NUM_SIZE];   /* paquets de la fenêtre déjà acquittés */
+    int reemis_sack[SEQ_NUM_SIZE]; /* trous déjà réémis sur SACK */
+    int liste[SEQ_NUM_SIZE];      /* paquets acquittés ou trous d'un SACK */
+    static paquet_t tab_ack[SEQ_NUM_SIZE]; /* acquittements reçus en un lot */
+    paquet_t *lot[SEQ_NUM_SIZE]; /* paquets remis ensemble à la couche réseau */
+
+    if (argc > 1) {
+        taille_fenetre = atoi(argv[1]);
+        /* Selective Repeat : la fenêtre ne doit pas dépasser
+         * la moitié de la capacité de numérotation */
+        if (taille_fenetre < 1 || taille_fenetre > SEQ_NUM_SIZE / 2) {
+            printf("[TRP] Taille de fenetre invalide (1 a %d).\n", SEQ_NUM_SIZE / 2);
+            exit(1);
+        }
+    }
+    if (argc > 3) {
+        if (argv[2][0] != '\0')
+            choisir_fichier_emission(argv[2]);
+        if (strlen(argv[3]) > LG_NOM_MAX) {
+            printf("[TRP] Nom de fichier trop long (%d caracteres max).\n", LG_NOM_MAX);
+            exit(1);
+        }
+    }
+    if (argc > 4) {
+        nb_flux = atoi(argv[4]);
+        if (nb_flux < 1 || nb_flux > NB_FLUX_MAX) {
+            printf("[TRP] Nombre de flux invalide (1 a %d).\n", NB_FLUX_MAX);
+            exit(1);
+        }
+    }
+
+    proposition.taille_fichier = 0;
+    proposition.decalage = 0;
+    if (nb_flux > 1)
+        lancer_flux(nb_flux, &proposition);
+
+    /* après lancer_flux() : un identifiant par flux */
+    id_con = nouvel_id_connexion();
+    init_reseau(EMISSION);
+    rto_init(&rto);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+
+    /* ouverture de connexion : proposition des paramètres locaux */
+    proposition.fenetre = taille_fenetre;
+    proposition.taille_info = conf_info_size();
+    proposition.controle = controles_supportes();
+    strcpy(proposition.nom, argc > 3 ? argv[3] : "");
+    con.type = CON_REQ;
+    con.num_seq = 0;
+    con.id_con = id_con;
+    ecrire_parametres(&con, &proposition);
+    con.somme_ctrl = generer_controle(&con);
+
+    if ( !echange(&con, CON_ACCEPT, &reponse, &rto) ) {
+        printf("[TRP] Pas de reponse du recepteur, abandon.\n");
+        exit(1);
+    }
+    /* le récepteur ne peut que réduire les valeurs proposées */
+    if ( reponse.type != CON_ACCEPT || !lire_parametres(&reponse, &accord) ||
+         accord.fenetre < 1 || accord.fenetre > proposition.fenetre ||
+         accord.taille_info < 1 || accord.taille_info > proposition.taille_info ||
+         (accord.controle != CTRL_CRC32C && accord.controle != CTRL_INTERNET) ) {
+        printf("[TRP] Connexion refusee par le recepteur.\n");
+        exit(1);
+    }
+    taille_fenetre = accord.fenetre;
+    conf_set_info_size(accord.taille_info);
+    choisir_controle(accord.controle);
+    congestion_init(&cc, algo_cc, taille_fenetre);
+
+    printf("[TRP] Connexion %08x etablie (fenetre %d, %d octets, controle %s, congestion %s).\n",
+           id_con, taille_fenetre, accord.taille_info,
+           accord.controle == CTRL_CRC32C ? "CRC32C" : "Internet", congestion_nom(&cc));
+
+    /* lecture de donnees provenant de la couche application */
+    message = de_application_ptr(&taille_msg);
+    fin = (taille_msg == 0);
+
+    /* tant qu'il reste des données à envoyer ou des paquets non acquittés
+     * (la fin du fichier est signalée par la fermeture de connexion) */
+    while ( !fin || borne_inf != curseur ) {
+
+        fenetre = congestion_fenetre(&cc);
+        if ( !fin && dans_fenetre(borne_inf, curseur, fenetre) ) {
+
+            /* construction de tous les paquets que la fenêtre autorise */
+            int premier = curseur;
+            nb = 0;
+            while ( !fin && dans_fenetre(borne_inf, curseur, fenetre) ) {
+                memcpy(tab_p[curseur].info, message, taille_msg);
+                tab_p[curseur].lg_info = taille_msg;
+                tab_p[curseur].type = DATA;
+                tab_p[curseur].num_seq = curseur;
+                tab_p[curseur].id_con = id_con;
+                tab_p[curseur].somme_ctrl = generer_controle(&tab_p[curseur]);
+                acquitte[curseur] = 0;
+                reemis_sack[curseur] = 0;
+                lot[nb++] = &tab_p[curseur];
+
+                curseur = inc(curseur, SEQ_NUM_SIZE);
+
+                /* lecture des donnees suivantes de la couche application */
+                message = de_application_ptr(&taille_msg);
+                fin = (taille_msg == 0);
+            }
+
+            /* remise du lot à la couche reseau, chaque temporisateur
+             * porte le numéro de séquence de son paquet */
+            vers_reseau_lot(lot, nb);
+            for (int i = premier; i != curseur; i = inc(i, SEQ_NUM_SIZE)) {
+                rto_emission(&rto, i, 0);
+                depart_temporisateur_num_us(i, rto.rto);
+            }
+        }
+        else {
+            evt = attendre();
+
+            if (evt == PAQUET_RECU) {
+                /* traitement de tous les acquittements disponibles */
+                nb = de_reseau_lot(tab_ack, SEQ_NUM_SIZE);
+                nouveaux = 0;
+                for (int k = 0; k < nb; k++) {
+                    paquet_t *pack = &tab_ack[k];
+                    /* acquittement valide ? (les CON_ACCEPT dupliqués
+                     * sont ignorés) */
+                    if ( !verifier_controle(pack) || pack->type != ACK || pack->id_con != id_con )
+                        continue;
+                    /* portant sur un paquet en vol ? */
+                    if ( dans_fenetre(borne_inf, pack->num_seq, en_vol(borne_inf, curseur)) &&
+                         !acquitte[pack->num_seq] ) {
+
+                        acquitte[pack->num_seq] = 1;
+                        arret_temporisateur_num(pack->num_seq);
+                        rto_acquittement(&rto, pack->num_seq);
+                        nouveaux++;
+                    }
+                    /* SACK : paquets dont l'acquittement a été perdu
+                     * (pas de mesure de RTT, la date d'arrivée est inconnue) */
+                    int n = lire_sack(pack, borne_inf, curseur, acquitte, liste);
+                    for (int j = 0; j < n; j++)
+                        arret_temporisateur_num(liste[j]);
+                    nouveaux += n;
+                }
+                congestion_acquittement(&cc, nouveaux, rto.srtt);
+
+                /* trous signalés par le SACK : réémission immédiate
+                 * (une seule fois, le temporisateur prend ensuite le relais) */
+                nb = trous_sack(borne_inf, curseur, acquitte, liste);
+                for (int j = 0; j < nb; j++) {
+                    int t = liste[j];
+                    if (reemis_sack[t])
+                        continue;
+                    reemis_sack[t] = 1;
+                    congestion_perte(&cc, rto.srtt);
+                    vers_reseau(&tab_p[t]);
+                    rto_emission(&rto, t, 1);
+                    /* le temporisateur du trou (en cours) repart du RTO courant */
+                    arret_temporisateur_num(t);
+                    depart_temporisateur_num_us(t, rto.rto);
+                }
+
+                /* glissement de la fenêtre sur les paquets acquittés */
+                while (borne_inf != curseur && acquitte[borne_inf])
+                    borne_inf = inc(borne_inf, SEQ_NUM_SIZE);
+            }
+            else {
+                /* timeout : réémission du seul paquet concerné */
+                rto_backoff(&rto);
+                congestion_expiration(&cc, rto.srtt);
+                vers_reseau(&tab_p[evt]);
+                rto_emission(&rto, evt, 1);
+                depart_temporisateur_num_us(evt, rto.rto);
+            }
+        }
+        /* paquets en vol et fenêtre de congestion (télémétrie,
+         * cf. PERIODE_CALCUL_DEBIT) */
+        perf_fenetre(en_vol(borne_inf, curseur));
+        if (algo_cc != CC_NONE)
+            perf_cwnd(cc.cwnd);
+        /* débit d'émission (RYTHME_EMISSION auto) : fenêtre de congestion
+         * par RTT */
+        rythme_emission(congestion_fenetre(&cc), rto.srtt);
+    }
+
+    /* fermeture de connexion : toutes les données sont acquittées */
+    con.type = CON_CLOSE;
+    con.num_seq = curseur;
+    con.lg_info = 0;
+    con.somme_ctrl = generer_controle(&con);
+    if ( !echange(&con, CON_CLOSE_ACK, &reponse, &rto) )
+        printf("[TRP] Fermeture non acquittee, abandon.\n");
+
+    printf("[TRP] Fin execution protocole transfert de donnees (TDD).\n");
+    return 0;
+}
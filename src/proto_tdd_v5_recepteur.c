@@ -0,0 +1,439 @@
+/*************************************************************
+* proto_tdd_v5 -  récepteur                                  *
+* TRANSFERT DE DONNEES  v5 (mode connecté)                   *
+*                                                            *
+* Sert plusieurs émetteurs à la fois, dans une seule boucle  *
+* d'évènements : chaque connexion (identifiant id_con choisi *
+* par l'émetteur) a sa fenêtre "Selective Repeat" (cf. v4),  *
+* son fichier reçu, son temporisateur et ses statistiques.   *
+* Avec ACK_DIFFERE n (config.txt), un acquittement (SACK)    *
+* pour n paquets reçus en séquence, ou au plus DELAI_ACK_US  *
+* après le premier ; immédiat hors séquence.                 *
+* Une demande de connexion est acceptée avec les paramètres  *
+* proposés, réduits aux limites locales (ou refusée faute de *
+* somme de contrôle commune) ; la fermeture de connexion     *
+* termine le fichier.                                        *
+*                                                            *
+* Un tronçon de fichier (transfert en plusieurs flux) est    *
+* écrit à sa place dans le fichier, par un processus par     *
+* flux.                                                      *
+*                                                            *
+* Usage : ./bin/recepteur [taille_fenetre_max [nb_con        *
+*                         [nb_flux]]]                        *
+*   nb_con : connexions à servir avant de terminer, par flux *
+*            (1 par défaut, 0 : sans fin)                    *
+*   nb_flux : flux parallèles (1 par défaut)                 *
+*                                                            *
+* E. Lavinal - Univ. de Toulouse III - Paul Sabatier         *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "application.h"
+#include "config.h"
+#include "couche_transport.h"
+#include "services_reseau.h"
+
+#define FENETRE_DEFAUT (SEQ_NUM_SIZE / 2) /* fenêtre maximale acceptée */
+
+/* durée de silence (ms) avant d'oublier une connexion fermée : permet
+ * de réacquitter la fermeture si le CON_CLOSE_ACK a été perdu */
+#define TEMPO_FIN 500
+
+/* durée de silence (ms) au-delà de laquelle une connexion ouverte est
+ * abandonnée (émetteur disparu) */
+#define TEMPO_INACTIVITE 30000
+
+#define LOT_MAX 64 /* paquets traités par lot (cf. de_reseau_lot) */
+
+#define NB_FLUX_MAX 16 /* flux parallèles (cf. émetteur) */
+
+/* états d'une connexion */
+#define LIBRE   0
+#define OUVERTE 1
+#define FERMEE  2 /* CON_CLOSE reçu, attente TEMPO_FIN avant d'oublier */
+
+typedef struct connexion_s {
+    uint32_t id_con;
+    int etat;
+    parametres_t accord;       /* paramètres retenus (réponse à CON_REQ) */
+    int paquet_attendu;        /* borne inférieure de la fenêtre */
+    uint8_t recu[SEQ_NUM_SIZE];      /* paquets reçus hors séquence */
+    uint16_t lg_info[SEQ_NUM_SIZE];
+    unsigned char *tampon;     /* SEQ_NUM_SIZE blocs de taille_info octets */
+    fichier_recu_t *fichier;
+    long long derniere_activite;     /* date du dernier paquet valide (us) */
+    /* acquittements différés */
+    int non_acquittes;         /* paquets reçus en séquence non acquittés */
+    int dernier_recu;          /* num_seq du dernier d'entre eux */
+    int tempo_ack;             /* temporisateur TEMPO_ACK en cours */
+    /* statistiques */
+    long long debut;           /* date d'ouverture (us) */
+    long octets;               /* données remises à l'application */
+    int paquets;               /* paquets de données reçus sans erreur */
+    int doublons;              /* paquets de données déjà reçus */
+} connexion_t;
+
+/* connexion c : temporisateur numéro c (inactivité, fin), et
+ * MAX_CONNEXIONS + c pour les acquittements différés */
+static connexion_t connexions[MAX_CONNEXIONS];
+#define TEMPO_ACK(con) (MAX_CONNEXIONS + (int)((con) - connexions))
+
+static int ack_differe; /* paquets en séquence par acquittement */
+static long delai_ack;  /* délai maximal d'un acquittement (us) */
+
+static connexion_t *chercher_connexion(uint32_t id_con)
+{
+    for (int c = 0; c < MAX_CONNEXIONS; c++)
+        if (connexions[c].etat != LIBRE && connexions[c].id_con == id_con)
+            return &connexions[c];
+    return NULL;
+}
+
+/* Réponse à un CON_REQ (aussi réémise si la demande est répétée) */
+static void envoyer_reponse(uint32_t id_con, int type, const parametres_t *accord)
+{
+    static paquet_t reponse;
+
+    reponse.type = type;
+    reponse.num_seq = 0;
+    reponse.id_con = id_con;
+    if (type == CON_ACCEPT)
+        ecrire_parametres(&reponse, accord);
+    else
+        reponse.lg_info = 0;
+    reponse.somme_ctrl = generer_controle(&reponse);
+    vers_reseau(&reponse);
+}
+
+/*
+ * Ouverture d'une connexion sur demande : paramètres proposés, réduits
+ * aux limites locales. Renvoie NULL (et refuse) si aucune somme de
+ * contrôle n'est commune, si le fichier ne peut être créé ou si le
+ * nombre maximal de connexions est atteint.
+ */
+static connexion_t *ouvrir(const paquet_t *demande, int fenetre_max)
+{
+    parametres_t proposition;
+    connexion_t *con = NULL;
+
+    for (int c = 0; c < MAX_CONNEXIONS && con == NULL; c++)
+        if (connexions[c].etat == LIBRE)
+            con = &connexions[c];
+
+    if ( con != NULL && lire_parametres(demande, &proposition) &&
+         proposition.fenetre >= 1 && proposition.taille_info >= 1 ) {
+
+        parametres_t *accord = &con->accord;
+        accord->fenetre = proposition.fenetre < fenetre_max ? proposition.fenetre : fenetre_max;
+        accord->taille_info = proposition.taille_info < MAX_INFO ? proposition.taille_info : MAX_INFO;
+        accord->controle = negocier_controle(controles_supportes(), proposition.controle);
+        strcpy(accord->nom, proposition.nom);
+        accord->taille_fichier = proposition.taille_fichier;
+        accord->decalage = proposition.decalage;
+
+        if (accord->controle != 0 &&
+            (con->tampon = malloc((size_t)SEQ_NUM_SIZE * accord->taille_info)) != NULL) {
+            con->fichier = accord->taille_fichier > 0 ?
+                ouvrir_troncon_recu(accord->nom, accord->taille_fichier, accord->decalage) :
+                ouvrir_fichier_recu(accord->nom);
+            if (con->fichier != NULL) {
+                con->id_con = demande->id_con;
+                con->etat = OUVERTE;
+                con->paquet_attendu = 0;
+                memset(con->recu, 0, sizeof(con->recu));
+                con->debut = con->derniere_activite = horloge_us();
+                con->octets = 0;
+                con->paquets = con->doublons = 0;
+                con->non_acquittes = 0;
+                con->tempo_ack = 0;
+                envoyer_reponse(con->id_con, CON_ACCEPT, accord);
+                /* surveillance de l'inactivité de l'émetteur */
+                depart_temporisateur_num(con - connexions, TEMPO_INACTIVITE);
+                printf("[TRP] Connexion %08x ouverte (fenetre %d, %d octets, controle %s, fichier %s).\n",
+                       con->id_con, accord->fenetre, accord->taille_info,
+                       accord->controle == CTRL_CRC32C ? "CRC32C" : "Internet",
+                       accord->nom[0] ? accord->nom : "FICHIER_OUT");
+                return con;
+            }
+            free(con->tampon);
+        }
+    }
+    envoyer_reponse(demande->id_con, CON_REFUSE, NULL);
+    oublier_connexion(demande->id_con);
+    printf("[TRP] Connexion %08x refusee.\n", demande->id_con);
+    return NULL;
+}
+
+/* Fin de réception : fichier complet (CON_CLOSE) ou abandonné */
+static void terminer(connexion_t *con, int complet)
+{
+    long long duree = horloge_us() - con->debut;
+
+    fermer_fichier_recu(con->fichier);
+    free(con->tampon);
+    printf("[TRP] Connexion %08x %s : %ld octets, %d paquets (%d doublons) en %.3f s (%.1f Mo/s).\n",
+           con->id_con, complet ? "terminee" : "abandonnee", con->octets,
+           con->paquets, con->doublons, duree / 1e6,
+           duree > 0 ? con->octets / (double)duree : 0.0);
+}
+
+/* Le slot de la connexion redevient libre */
+static void liberer(connexion_t *con)
+{
+    if (con->tempo_ack)
+        arret_temporisateur_num(TEMPO_ACK(con));
+    con->tempo_ack = 0;
+    oublier_connexion(con->id_con);
+    con->etat = LIBRE;
+}
+
+/*
+ * Paquet de données d'une connexion ouverte : mémorisation, remise dans
+ * l'ordre à l'application. Renvoie 1 s'il faut l'acquitter.
+ */
+static int recevoir_donnees(connexion_t *con, const paquet_t *p)
+{
+    int taille_fenetre = con->accord.fenetre;
+    int taille_info = con->accord.taille_info;
+
+    if (p->lg_info > taille_info)
+        return 0;
+    con->paquets++;
+
+    if ( dans_fenetre(con->paquet_attendu, p->num_seq, taille_fenetre) ) {
+        if (con->recu[p->num_seq])
+            con->doublons++;
+        /* mémorisation (les doublons sont écrasés à l'identique) */
+        memcpy(con->tampon + (size_t)p->num_seq * taille_info, p->info, p->lg_info);
+        con->lg_info[p->num_seq] = p->lg_info;
+        con->recu[p->num_seq] = 1;
+
+        /* remise dans l'ordre des paquets consécutifs disponibles */
+        while ( con->recu[con->paquet_attendu] ) {
+            int n = con->paquet_attendu;
+            ecrire_fichier_recu(con->fichier, con->tampon + (size_t)n * taille_info, con->lg_info[n]);
+            con->octets += con->lg_info[n];
+            con->recu[n] = 0;
+            con->paquet_attendu = inc(n, SEQ_NUM_SIZE);
+        }
+        return 1;
+    }
+    /* déjà remis (acquittement perdu) : à réacquitter */
+    con->doublons++;
+    return dans_fenetre((con->paquet_attendu - taille_fenetre + SEQ_NUM_SIZE) % SEQ_NUM_SIZE,
+                        p->num_seq, taille_fenetre);
+}
+
+/* Masque SACK : paquets de la fenêtre reçus hors séquence */
+static uint16_t masque_recu(const connexion_t *con)
+{
+    uint16_t masque = 0;
+
+    for (int b = 0; b < con->accord.fenetre - 1; b++)
+        if (con->recu[(con->paquet_attendu + 1 + b) % SEQ_NUM_SIZE])
+            masque |= 1 << b;
+    return masque;
+}
+
+/* Acquittement (avec SACK) du paquet num_seq */
+static void ecrire_ack(paquet_t *ack, const connexion_t *con, int num_seq)
+{
+    ack->type = ACK;
+    ack->num_seq = num_seq;
+    ack->id_con = con->id_con;
+    ecrire_sack(ack, con->paquet_attendu, masque_recu(con));
+    ack->somme_ctrl = generer_controle(ack);
+}
+
+/* =============================== */
+/* Programme principal - récepteur */
+/* =============================== */
+int main(int argc, char* argv[])
+{
+    int fenetre_max = FENETRE_DEFAUT;
+    int nb_con = 1;      /* connexions à servir (0 : sans fin) */
+    int nb_flux = 1;     /* flux parallèles, un processus chacun */
+    int nb_terminees = 0;
+    int nb_actives = 0;  /* connexions ouvertes ou en attente d'oubli */
+    int evt; /* évènement retourné par attendre() */
+    int nb, nb_ack; /* nombre de paquets reçus / d'acquittements d'un lot */
+
+    static paquet_t tab_p[LOT_MAX];   /* paquets reçus en un lot */
+    static paquet_t tab_ack[LOT_MAX]; /* acquittements émis en un lot */
+    paquet_t *lot[LOT_MAX];
+
+    if (argc > 1) {
+        fenetre_max = atoi(argv[1]);
+        if (fenetre_max < 1 || fenetre_max > SEQ_NUM_SIZE / 2) {
+            printf("[TRP] Taille de fenetre invalide (1 a %d).\n", SEQ_NUM_SIZE / 2);
+            exit(1);
+        }
+    }
+    if (argc > 2)
+        nb_con = atoi(argv[2]);
+    ack_differe = conf_ack_every();
+    delai_ack = conf_ack_delay_us();
+    if (argc > 3) {
+        nb_flux = atoi(argv[3]);
+        if (nb_flux < 1 || nb_flux > NB_FLUX_MAX) {
+            printf("[TRP] Nombre de flux invalide (1 a %d).\n", NB_FLUX_MAX);
+            exit(1);
+        }
+    }
+
+    if (nb_flux > 1) {
+        /* un processus par flux, le père attend la fin de tous */
+        int echecs = 0, statut;
+        for (int i = 0; i < nb_flux; i++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("[TRP] Problème création d'un flux !\n");
+                exit(1);
+            }
+            if (pid == 0) {
+                choisir_flux(i);
+                break;
+            }
+            if (i == nb_flux - 1) {
+                while (wait(&statut) > 0)
+                    if (!WIFEXITED(statut) || WEXITSTATUS(statut) != 0)
+                        echecs++;
+                printf("[TRP] %d flux termines, %d en echec.\n", nb_flux, echecs);
+                exit(echecs > 0);
+            }
+        }
+    }
+
+    init_reseau(RECEPTION);
+
+    printf("[TRP] Initialisation reseau : OK.\n");
+
+    /* tant qu'il reste des connexions à servir ou à terminer */
+    while ( nb_con == 0 || nb_terminees < nb_con || nb_actives > 0 ) {
+
+        evt = attendre();
+
+        if (evt >= MAX_CONNEXIONS) {
+            /* acquittement différé : délai écoulé */
+            static paquet_t ack;
+            connexion_t *con = &connexions[evt - MAX_CONNEXIONS];
+            con->tempo_ack = 0;
+            if (con->etat == OUVERTE && con->non_acquittes > 0) {
+                choisir_controle(con->accord.controle);
+                ecrire_ack(&ack, con, con->dernier_recu);
+                vers_reseau(&ack);
+                con->non_acquittes = 0;
+            }
+            continue;
+        }
+        if (evt != PAQUET_RECU) {
+            /* temporisateur de la connexion evt */
+            connexion_t *con = &connexions[evt];
+            long long silence = (horloge_us() - con->derniere_activite) / 1000;
+
+            if (con->etat == FERMEE) {
+                liberer(con);
+                nb_actives--;
+            }
+            else if (silence < TEMPO_INACTIVITE) {
+                /* activité depuis le départ : réarmement pour le reste */
+                depart_temporisateur_num(evt, TEMPO_INACTIVITE - silence);
+            }
+            else {
+                terminer(con, 0);
+                liberer(con);
+                nb_actives--;
+                nb_terminees++;
+            }
+            continue;
+        }
+
+        /* tous les paquets disponibles sont traités en un lot */
+        nb = de_reseau_lot(tab_p, LOT_MAX);
+        nb_ack = 0;
+
+        for (int k = 0; k < nb; k++) {
+            paquet_t *p = &tab_p[k];
+            connexion_t *con = chercher_connexion(p->id_con);
+
+            if (p->type == CON_REQ) {
+                /* les paquets CON_* utilisent toujours le CRC32C */
+                if ( !verifier_controle(p) )
+                    continue;
+                if (con == NULL) {
+                    if (ouvrir(p, fenetre_max) != NULL)
+                        nb_actives++;
+                }
+                else if (con->etat == OUVERTE)
+                    /* CON_ACCEPT perdu : l'émetteur répète sa demande */
+                    envoyer_reponse(con->id_con, CON_ACCEPT, &con->accord);
+                continue;
+            }
+
+            /* paquet d'une connexion inconnue ou erroné : ignoré */
+            if (con == NULL)
+                continue;
+            choisir_controle(con->accord.controle);
+            if ( !verifier_controle(p) )
+                continue;
+            con->derniere_activite = horloge_us();
+
+            if (p->type == CON_CLOSE) {
+                if (con->etat == OUVERTE) {
+                    /* toutes les données ont été acquittées : fin du fichier */
+                    terminer(con, 1);
+                    con->etat = FERMEE;
+                    nb_terminees++;
+                    arret_temporisateur_num(con - connexions);
+                    depart_temporisateur_num(con - connexions, TEMPO_FIN);
+                }
+                /* acquittement de la fermeture, réémis tant que
+                 * l'émetteur répète son CON_CLOSE */
+                tab_ack[nb_ack].type = CON_CLOSE_ACK;
+                tab_ack[nb_ack].num_seq = 0;
+                tab_ack[nb_ack].lg_info = 0;
+                tab_ack[nb_ack].id_con = con->id_con;
+                tab_ack[nb_ack].somme_ctrl = generer_controle(&tab_ack[nb_ack]);
+            }
+            else if (p->type == DATA && con->etat == OUVERTE) {
+                /* reçu hors séquence, ou alors qu'il manque un paquet :
+                 * acquittement immédiat (cf. RFC 5681) */
+                int immediat = p->num_seq != con->paquet_attendu || masque_recu(con) != 0;
+
+                if ( !recevoir_donnees(con, p) )
+                    continue;
+                /* un acquittement pour ack_differe paquets en séquence */
+                con->dernier_recu = p->num_seq;
+                if (!immediat && ++con->non_acquittes < ack_differe) {
+                    if (!con->tempo_ack) {
+                        depart_temporisateur_num_us(TEMPO_ACK(con), delai_ack);
+                        con->tempo_ack = 1;
+                    }
+                    continue;
+                }
+                /* acquittement individuel (y compris des paquets déjà
+                 * remis, dont l'acquittement a pu être perdu), avec le
+                 * SACK qui couvre aussi les paquets en attente */
+                con->non_acquittes = 0;
+                if (con->tempo_ack) {
+                    arret_temporisateur_num(TEMPO_ACK(con));
+                    con->tempo_ack = 0;
+                }
+                ecrire_ack(&tab_ack[nb_ack], con, p->num_seq);
+            }
+            else
+                continue;
+
+            lot[nb_ack] = &tab_ack[nb_ack];
+            nb_ack++;
+        }
+        vers_reseau_lot(lot, nb_ack);
+    }
+
+    printf("[TRP] Fin execution protocole transport.\n");
+    return 0;
+}
@@ -11,8 +11,11 @@
  * Université Toulouse III - Paul Sabatier                          *
  ********************************************************************/
 
+#define _GNU_SOURCE /* sendmmsg, recvmmsg */
+
 #include "config.h"
 #include "services_reseau.h"
+#include "trace.h"
 
 #include <pthread.h>
 #include <stdio.h>
@@ -23,10 +26,19 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h> /* offsetof */
+#include <stdint.h> /* uintptr_t */
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <linux/net_tstamp.h> /* struct sock_txtime */
 
 #include <time.h>
 
@@ -41,9 +53,14 @@
 #define SENDER_PORT 42525
 #define RECEIVER_PORT 42526
 
-#define MAX_TIMERS 32
+#define MAX_TIMERS MAX_TEMPORISATEURS
+
+/* Max number of packets per sendmmsg/recvmmsg call */
+#define MAX_BATCH 64
 
-#define MAX_PERF_ARRAY 10000
+/* On the wire, a packet is its header followed by lg_info bytes of info */
+#define HEADER_LEN ((int)offsetof(paquet_t, info))
+#define FRAME_LEN(p) (HEADER_LEN + (p)->lg_info)
 
 /* Internal variables */
 /* ------------------ */
@@ -55,69 +72,215 @@ static netlib_config_t nl_conf = { 0 };
 /* Socket */
 static int sock;
 
+/* io_uring backend in use (see uring_init), and its send operation:
+ * the first one refused by the kernel (-EINVAL) is replaced by the
+ * next one for the rest of the run */
+#define URING_SEND_ZC 0  /* IORING_OP_SEND_ZC from the registered pool */
+#define URING_SEND_TO 1  /* IORING_OP_SEND with a destination (copy) */
+#define URING_SENDMSG 2  /* IORING_OP_SENDMSG */
+static int use_uring = 0;
+static int send_mode = URING_SEND_ZC;
+static int uring_init();
+
+/* Event loop: epoll instance watching the socket and a timerfd, both
+ * edge-triggered. The timerfd is armed on the earliest timer of the
+ * heap below (never later than it, see arm_timerfd). */
+static int epfd;
+static int tfd;
+static long long armed_deadline = 0; /* 0: timerfd not armed */
+static int sock_readable = 0; /* edge seen, socket not drained yet */
+
 /* Communication role (sender or receiver) */
 static int my_role = 0;
 
+/* Flow number of a striped transfer: flow n uses both static ports
+ * + 2n (the sender and receiver ports are adjacent) */
+static int flow = 0;
+
 /* Timers */
+/* Running timers are kept in a binary min-heap ordered by their absolute
+ * expiry date (CLOCK_MONOTONIC, in ns): the next timer to expire is always
+ * timers[0]. timer_pos[n] gives the heap index of timer n plus one
+ * (0 if timer n is not running) so that stopping a timer is O(log n). */
 typedef struct my_timer_t
 {
     int num_timer;
-    int exp;
+    long long deadline; /* absolute expiry date (ns) */
 } my_timer_t;
 
 static my_timer_t timers[MAX_TIMERS];
 static int num_timers = 0;
+static int timer_pos[MAX_TIMERS];
 
 /* Init state */
 static int net_initialized = 0;
 
 /* Remote host (string IPv4 addr)*/
 static char remote_ipv4[INET_ADDRSTRLEN]; // INET_ADDRSTRLEN == 16 bytes
+static struct sockaddr_in dst_addr; // remote host and port, set at init
+
+/* Connected mode: remote address of each connection, learnt by the
+ * receiver from the connection's CON_REQ so that several senders can
+ * share its socket. Packets of any other connection go to dst_addr. */
+typedef struct connection_t
+{
+    uint32_t id_con; /* 0: free entry */
+    struct sockaddr_in addr;
+} connection_t;
+
+static connection_t connections[MAX_CONNEXIONS];
+static int num_connections = 0;
+
+/* Sender's telemetry (PERIODE_CALCUL_DEBIT), cumulative counters.
+ * Each counter has a single writer, the protocol thread, and is read by
+ * the perf thread: relaxed atomic loads and stores are enough, no locked
+ * instruction is needed on the fast path. */
+typedef struct telemetry_s {
+    atomic_long packets;
+    atomic_long bytes;
+    atomic_long losses;
+    atomic_long retransmits;
+    atomic_long rtt_samples;
+    atomic_long rtt_sum_us;
+    atomic_int window;          /* packets in flight (last value) */
+    atomic_int cwnd;            /* congestion window x 100 (last value) */
+    atomic_int end;             /* last packet sent, perf thread stops */
+} telemetry_t;
 
-/* Variables to plot performance */
 static pthread_t perf_thid;
-static int sent_packet_count = 0;
-static int packet_loss_count = 0;
-static int end_communication = 0;
+/* own cache line: the perf thread's reads do not share it with hot data */
+static _Alignas(64) telemetry_t perf;
 
 /* Last data packet bool used for last ACK loss */
 static int last_data_pkt = 0;
 
+/* Scratch frames used to corrupt a copy of a packet (error injection)
+ * without touching the caller's packet: one per packet of a batch,
+ * allocated once at init (pages are only touched when an error is drawn) */
+static paquet_t *scratch_frames = NULL;
+
+/* Sender pacing (RYTHME_EMISSION): token bucket refilled at pacing_rate
+ * bytes/s, at most PACING_BURST full frames (or PACING_QUANTUM_US worth
+ * of rate) deep. Tokens may go negative: each frame gets the date at
+ * which the debt is paid back, and leaves at that date, queued here and
+ * sent from attendre() when the timerfd fires, or held by the kernel
+ * (SO_TXTIME) if RYTHME_TXTIME says the egress qdisc honours it. */
+#define PACING_BURST 2
+#define PACING_QUANTUM_US 100
+#define PACING_GAIN 1.25  /* auto rate: cwnd / SRTT with some headroom */
+#define PACING_QUEUE (2 * SEQ_NUM_SIZE)
+
+typedef struct paced_frame_t
+{
+    long long departure; /* absolute date (ns) */
+    struct sockaddr_in to;
+    paquet_t frame;
+} paced_frame_t;
+
+static long pacing_rate = 0;       /* bytes/s, 0: frames sent at once */
+static double pacing_tokens = 0;   /* bytes */
+static long long pacing_refill = 0; /* date (ns) of the last refill */
+static long long pacing_last = 0;   /* departure date (ns) of the last frame */
+static int use_txtime = 0;
+static paced_frame_t *paced = NULL; /* FIFO (timer-driven fallback) */
+static int paced_head = 0, paced_count = 0;
+static void pacing_flush(int wait);
+static void pacing_drain();
+
 /* ========================================================================= */
 /* ========================================================================= */
 
-// Perf eval thread to plot sender's perf
-void *perf_eval_thread(void *args) {
+// Single writer increment (see telemetry_t)
+static inline void perf_add(atomic_long *counter, long n) {
 
-    struct telemetry_point {
-        short packet_count;
-        short loss_count;
-    };
-    struct telemetry_point perf_array[MAX_PERF_ARRAY];
-    int number_of_points = 0;
-    int sent_packet_count_prev = 0;
-    int packet_loss_count_prev = 0;
+    atomic_store_explicit(counter,
+                          atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
 
-    while (!end_communication) {
+void perf_reemission() {
 
-        usleep(nl_conf.plot_period_ms * 1000);
-        perf_array[number_of_points].packet_count = sent_packet_count - sent_packet_count_prev;
-        perf_array[number_of_points].loss_count = packet_loss_count - packet_loss_count_prev;
-        sent_packet_count_prev = sent_packet_count;
-        packet_loss_count_prev = packet_loss_count;
-        number_of_points++;
-    }
+    perf_add(&perf.retransmits, 1);
+}
+
+void perf_rtt(long rtt_us) {
+
+    perf_add(&perf.rtt_samples, 1);
+    perf_add(&perf.rtt_sum_us, rtt_us);
+}
+
+void perf_fenetre(int en_vol) {
+
+    atomic_store_explicit(&perf.window, en_vol, memory_order_relaxed);
+}
+
+void perf_cwnd(double cwnd) {
+
+    atomic_store_explicit(&perf.cwnd, (int)(cwnd * 100), memory_order_relaxed);
+}
+
+// Perf eval thread to plot sender's perf: one line per period, written
+// (and flushed) as the transfer goes so that plot_perf.py can follow it.
+// Time is the real sampling date, in ms with a us resolution.
+static void *perf_eval_thread(void *args) {
 
-    FILE *perf_file = fopen("perf.txt", "wt");
+    enum { PACKETS, BYTES, LOSSES, RETRANSMITS, RTT_SAMPLES, RTT_SUM, NB_COUNTERS };
+    atomic_long *counters[NB_COUNTERS] = {
+        &perf.packets, &perf.bytes, &perf.losses,
+        &perf.retransmits, &perf.rtt_samples, &perf.rtt_sum_us
+    };
+    long prev[NB_COUNTERS] = { 0 }, delta[NB_COUNTERS];
+    char file_name[32];
+    struct timespec start, next, now;
+    int end;
+
+    // one file per flow of a striped transfer
+    if (flow == 0)
+        snprintf(file_name, sizeof(file_name), "perf.txt");
+    else
+        snprintf(file_name, sizeof(file_name), "perf_%d.txt", flow);
+    FILE *perf_file = fopen(file_name, "wt");
     if (perf_file == NULL) {
         perror("[NET] Error creating file: ");
         exit(1);
     }
-    fprintf(perf_file, "Time; Packet; Loss\n");
-    for (int i=0; i<number_of_points; i++)
-        fprintf(perf_file, "%d; %d; %d\n", (i + 1) * nl_conf.plot_period_ms, perf_array[i].packet_count, perf_array[i].loss_count);
+    fprintf(perf_file, "Time; Packet; Loss; Bytes; Retransmit; RTT; Window; Cwnd\n");
+    fflush(perf_file);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    do {
+        // absolute deadlines: no drift from the time spent writing
+        next.tv_nsec += (long)nl_conf.plot_period_ms * 1000000;
+        next.tv_sec += next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+        end = atomic_load_explicit(&perf.end, memory_order_acquire);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        // woken up more than a period late: missed periods are merged
+        // into this one rather than caught up with empty samples
+        if ((now.tv_sec - next.tv_sec) * 1000000000L + now.tv_nsec - next.tv_nsec >
+            nl_conf.plot_period_ms * 1000000L)
+            next = now;
+        for (int i = 0; i < NB_COUNTERS; i++) {
+            long value = atomic_load_explicit(counters[i], memory_order_relaxed);
+            delta[i] = value - prev[i];
+            prev[i] = value;
+        }
+        // mean RTT of the period (us), 0 without sample; congestion
+        // window, 0 without congestion control
+        fprintf(perf_file, "%.3f; %ld; %ld; %ld; %ld; %ld; %d; %.2f\n",
+                (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6,
+                delta[PACKETS], delta[LOSSES], delta[BYTES], delta[RETRANSMITS],
+                delta[RTT_SAMPLES] > 0 ? delta[RTT_SUM] / delta[RTT_SAMPLES] : 0,
+                atomic_load_explicit(&perf.window, memory_order_relaxed),
+                atomic_load_explicit(&perf.cwnd, memory_order_relaxed) / 100.0);
+        fflush(perf_file);
+    } while (!end);
+
     fclose(perf_file);
-    printf("[NET] Performance trace written in perf.txt!\n");
+    printf("[NET] Performance trace written in %s!\n", file_name);
 
     pthread_exit(NULL);
 }
@@ -128,13 +291,30 @@ void *perf_eval_thread(void *args) {
 int local_port() {
 
     int port = (my_role==SENDER)?SENDER_PORT:RECEIVER_PORT;
-    return port;
+    return port + 2 * flow;
 }
 
 int remote_port() {
 
     int port = (my_role==SENDER)?RECEIVER_PORT:SENDER_PORT;
-    return port;
+    return port + 2 * flow;
+}
+
+void choisir_flux(int n) {
+
+    flow = n;
+}
+
+// Raise a socket buffer (SO_RCVBUF or SO_SNDBUF) to at least size bytes
+static void grow_socket_buffer(int option, int size) {
+
+    int current;
+    socklen_t len = sizeof(current);
+
+    // the kernel reports twice the value that was set
+    if (getsockopt(sock, SOL_SOCKET, option, &current, &len) == 0 && current / 2 >= size)
+        return;
+    setsockopt(sock, SOL_SOCKET, option, &size, sizeof(size));
 }
 
 void init_network(int role, char *remote_host) {
@@ -150,6 +330,9 @@ void init_network(int role, char *remote_host) {
     }
     else
         conf_net_receiver(&nl_conf);
+    nl_conf.info_size = conf_info_size();
+    // buffered traces (level NIVEAU_TRACE)
+    trace_init();
     // rand
     srand((unsigned)time(NULL));
     // socket
@@ -158,23 +341,102 @@ void init_network(int role, char *remote_host) {
         perror("socket() error: ");
         exit(1);
     }
+    // scratch frames for error injection
+    scratch_frames = malloc(MAX_BATCH * sizeof(paquet_t));
+    if (scratch_frames == NULL) {
+        perror("malloc() error: ");
+        exit(1);
+    }
+    // socket buffers large enough for a full window of (jumbo) packets
+    // (best effort: capped by net.core.rmem_max / wmem_max), never below
+    // the system default, which small packets need for their overhead
+    int buf_size = SEQ_NUM_SIZE * (HEADER_LEN + nl_conf.info_size);
+    grow_socket_buffer(SO_RCVBUF, buf_size);
+    grow_socket_buffer(SO_SNDBUF, buf_size);
     struct sockaddr_in local_addr;
+    socklen_t addr_len = sizeof(local_addr);
     local_addr.sin_port = htons(local_port());
     local_addr.sin_family = AF_INET;
     local_addr.sin_addr.s_addr = INADDR_ANY;    
     if (bind(sock, (struct sockaddr *)&local_addr, sizeof(local_addr)) < 0) {
-        perror("bind() error: ");
+        // another sender already runs on this host: take any free port
+        // (in connected mode, the receiver answers to the CON_REQ's address)
+        local_addr.sin_port = 0;
+        if (my_role != SENDER || errno != EADDRINUSE ||
+            bind(sock, (struct sockaddr *)&local_addr, sizeof(local_addr)) < 0) {
+            perror("bind() error: ");
+            close(sock);
+            exit(1);
+        }
+    }
+    getsockname(sock, (struct sockaddr *)&local_addr, &addr_len);
+    // event loop: socket and timers in one epoll set
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epfd < 0 || tfd < 0) {
+        perror("epoll/timerfd error: ");
         close(sock);
         exit(1);
     }
+    // io_uring backend: the ring is watched instead of the socket
+    // (readable when a completion is posted)
+    int ring_fd = -1;
+    if (nl_conf.backend == BACKEND_URING) {
+        ring_fd = uring_init();
+        use_uring = ring_fd >= 0;
+        if (!use_uring)
+            printf("[NET] io_uring unavailable, using socket calls.\n");
+    }
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLET };
+    ev.data.fd = use_uring ? ring_fd : sock;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.fd = tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
     // state
     net_initialized = 1;
     // remote host
     strcpy(remote_ipv4, remote_host);
+    // init remote server addr (once, for every vers_reseau)
+    dst_addr.sin_family = AF_INET;
+    dst_addr.sin_port = htons(remote_port()); /* htons: host to net byte order (short int) */
+    inet_pton(AF_INET, remote_ipv4, &(dst_addr.sin_addr));
+    // TODO. check "localhost" with inet_pton...
+    // sender pacing: frames queued here until their departure date, or
+    // handed to the kernel with it (SO_TXTIME) on request only: the
+    // setsockopt succeeds whatever the qdisc, and only fq and etf hold
+    // the frames (not with io_uring, whose sends carry no cmsg)
+    if (my_role == SENDER && nl_conf.pacing_rate != PACING_NONE) {
+        if (nl_conf.pacing_rate > 0)
+            pacing_rate = nl_conf.pacing_rate;
+#ifdef SO_TXTIME
+        struct sock_txtime txtime = { .clockid = CLOCK_MONOTONIC, .flags = 0 };
+        use_txtime = nl_conf.pacing_txtime && !use_uring &&
+                     setsockopt(sock, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == 0;
+#endif
+        if (nl_conf.pacing_txtime && !use_txtime)
+            fprintf(stderr, "[NET] SO_TXTIME unavailable, pacing with the timer queue\n");
+        if (!use_txtime) {
+            paced = malloc(PACING_QUEUE * sizeof(paced_frame_t));
+            if (paced == NULL) {
+                perror("malloc() error: ");
+                exit(1);
+            }
+            atexit(pacing_drain);
+        }
+    }
 
-    printf("[NET] INIT NETWORK LAYER OK (with local port %d).\n", local_port());
+    printf("[NET] INIT NETWORK LAYER OK (with local port %d).\n", ntohs(local_addr.sin_port));
     printf("[NET] (using %.2f loss and %.2f error probability)\n",
             nl_conf.loss_proba, nl_conf.error_proba);
+    printf("[NET] (using %d bytes payload)\n", nl_conf.info_size);
+    if (use_uring)
+        printf("[NET] (using io_uring, %s sends)\n",
+               send_mode == URING_SEND_ZC ? "zero-copy registered buffer" : "copied");
+    if (nl_conf.pacing_rate == PACING_AUTO)
+        printf("[NET] (pacing at cwnd / SRTT, %s)\n", use_txtime ? "SO_TXTIME" : "timer");
+    else if (pacing_rate > 0)
+        printf("[NET] (pacing at %.1f Mbit/s, %s)\n", pacing_rate * 8 / 1e6,
+               use_txtime ? "SO_TXTIME" : "timer");
 
 }
 
@@ -197,6 +459,546 @@ void init_reseau_mode_reparti(int role, char *hote_distant) {
     init_network(role, hote_distant);
 }
 
+/* ========================================================================= */
+/* ========================================================================= */
+
+// Monotonic clock, in ns
+static long long now_ns() {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void heap_set(int i, my_timer_t t) {
+
+    timers[i] = t;
+    timer_pos[t.num_timer] = i + 1;
+}
+
+static void heap_sift_up(int i) {
+
+    my_timer_t t = timers[i];
+    while (i > 0 && timers[(i - 1) / 2].deadline > t.deadline) {
+        heap_set(i, timers[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heap_set(i, t);
+}
+
+static void heap_sift_down(int i) {
+
+    my_timer_t t = timers[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= num_timers)
+            break;
+        if (child + 1 < num_timers && timers[child + 1].deadline < timers[child].deadline)
+            child++;
+        if (timers[child].deadline >= t.deadline)
+            break;
+        heap_set(i, timers[child]);
+        i = child;
+    }
+    heap_set(i, t);
+}
+
+// Remove the timer at heap index i
+static void heap_remove(int i) {
+
+    timer_pos[timers[i].num_timer] = 0;
+    num_timers--;
+    if (i == num_timers)
+        return;
+    // move the last timer into the hole, then restore the heap order
+    heap_set(i, timers[num_timers]);
+    if (i > 0 && timers[(i - 1) / 2].deadline > timers[i].deadline)
+        heap_sift_up(i);
+    else
+        heap_sift_down(i);
+}
+
+// Entry of connection id_con (0: a free entry), NULL if none
+static connection_t *find_connection(uint32_t id_con) {
+
+    for (int i = 0; i < MAX_CONNEXIONS; i++)
+        if (connections[i].id_con == id_con)
+            return &connections[i];
+    return NULL;
+}
+
+// Receiver: record the sender's address of a new connection (CON_REQ),
+// and follow it if it changes during the connection
+static void learn_address(paquet_t *packet, struct sockaddr_in *from) {
+
+    connection_t *c = NULL;
+
+    if (my_role != RECEIVER || packet->id_con == 0)
+        return;
+    if (num_connections > 0)
+        c = find_connection(packet->id_con);
+    if (c == NULL) {
+        if (packet->type != CON_REQ)
+            return;
+        c = find_connection(0);
+        if (c == NULL) {
+            TRACE(TRACE_ERROR, "%s[NET] too many connections (%d).%s\n", RED, MAX_CONNEXIONS, NRM);
+            return;
+        }
+        c->id_con = packet->id_con;
+        num_connections++;
+    }
+    c->addr = *from;
+}
+
+// Remote address of a packet: the one of its connection, if known
+static struct sockaddr_in *destination(paquet_t *packet) {
+
+    if (num_connections > 0 && packet->id_con != 0) {
+        connection_t *c = find_connection(packet->id_con);
+        if (c != NULL)
+            return &c->addr;
+    }
+    return &dst_addr;
+}
+
+void oublier_connexion(uint32_t id_con) {
+
+    connection_t *c = id_con != 0 ? find_connection(id_con) : NULL;
+
+    if (c != NULL) {
+        c->id_con = 0;
+        num_connections--;
+    }
+}
+
+// Is the datagram length consistent with the header it carries?
+static int valid_datagram(paquet_t *packet, int data_len) {
+
+    if (data_len >= HEADER_LEN && data_len == FRAME_LEN(packet))
+        return 1;
+    TRACE(TRACE_EVENT, "%s[NET] malformed datagram dropped (%d bytes).%s\n", RED, data_len, NRM);
+    return 0;
+}
+
+// Peek at the header of the pending datagram without consuming it:
+// a truncated or oversized datagram is dropped right away (returns 0),
+// a valid one is left in the socket for de_reseau() (returns 1).
+// Returns -1 if no datagram is pending.
+static int check_pending_datagram() {
+
+    paquet_t header;
+    int data_len = recv(sock, (char *)&header, HEADER_LEN, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+    if (data_len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return -1;
+        if (errno == EINTR)
+            return 0;
+        perror("recv() error: ");
+        close(sock);
+        exit(1);
+    }
+    if (valid_datagram(&header, data_len))
+        return 1;
+    recv(sock, (char *)&header, 0, MSG_DONTWAIT); // discard it
+    return 0;
+}
+
+/* ========================================================================= */
+/* io_uring backend (BACKEND_RESEAU io_uring)                                */
+/* ========================================================================= */
+
+/* Sends: the frame is copied into a slot of a buffer pool registered once
+ * with the ring and queued (zero-copy IORING_OP_SEND_ZC from the pool,
+ * see send_mode for the fallbacks); all the sends of a call go out with
+ * one io_uring_enter, without waiting for the socket.
+ * Receives: a single multishot IORING_OP_RECVMSG stays posted and fills
+ * URING_RECV_BUFS buffers provided to the kernel in a buffer ring (one
+ * posted request per buffer would arm as many polls on the socket, all
+ * woken by each datagram). Completions are reaped from the CQ ring
+ * without any syscall. */
+#define URING_ENTRIES 256
+#define URING_RECV_BUFS 64 /* power of 2 (buffer ring) */
+#define URING_SEND_SLOTS 128
+#define URING_BGID 0       /* buffer group of the receive buffers */
+/* a receive buffer: io_uring_recvmsg_out, source address, then the frame */
+#define URING_RECV_LEN ((sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + \
+                         sizeof(paquet_t) + 63) & ~(size_t)63)
+#define URING_SEND_LEN ((sizeof(paquet_t) + 63) & ~(size_t)63)
+
+/* user_data of a request: kind << 16 | send slot */
+#define URING_RECV 1
+#define URING_SEND 2
+
+typedef struct uring_send_t
+{
+    paquet_t *frame; /* in the registered pool */
+    int len;
+    int retry;       /* send refused, posted again once notified */
+    struct sockaddr_in addr;
+    struct iovec iov;
+    struct msghdr msg;
+} uring_send_t;
+
+typedef struct uring_recv_t
+{
+    int bid;  /* receive buffer */
+    int len;  /* datagram length */
+} uring_recv_t;
+
+static struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit; /* SQEs queued, not submitted yet */
+    // receive buffers and the ring that provides them to the kernel
+    unsigned char *recv_bufs;
+    struct io_uring_buf_ring *buf_ring;
+    struct msghdr recv_msg; /* multishot template: source address length */
+    int recv_armed;         /* multishot RECVMSG posted */
+    uring_recv_t ready[URING_RECV_BUFS]; /* datagrams received, in order */
+    int ready_head, ready_count;
+    uring_send_t send[URING_SEND_SLOTS];
+    int free_send[URING_SEND_SLOTS];
+    int num_free_send;
+} ring;
+
+// Submit the queued SQEs and, if wait, block for at least one completion
+static void uring_submit(int wait) {
+
+    for (;;) {
+        int rep = syscall(__NR_io_uring_enter, ring.fd, ring.to_submit, wait,
+                          wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (rep < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("io_uring_enter error: ");
+            exit(1);
+        }
+        ring.to_submit -= rep;
+        if (ring.to_submit == 0)
+            return;
+    }
+}
+
+// Next free SQE (zeroed), made visible to the kernel by uring_push()
+static struct io_uring_sqe *uring_sqe() {
+
+    unsigned tail = *ring.sq_tail;
+    if (tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) == ring.sq_entries)
+        uring_submit(0); // SQ ring full
+    struct io_uring_sqe *sqe = &ring.sqes[tail & *ring.sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static void uring_push() {
+
+    unsigned tail = *ring.sq_tail;
+    ring.sq_array[tail & *ring.sq_mask] = tail & *ring.sq_mask;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring.to_submit++;
+}
+
+// Give receive buffer bid back to the kernel
+static void uring_provide(int bid) {
+
+    unsigned short tail = ring.buf_ring->tail;
+    struct io_uring_buf *buf = &ring.buf_ring->bufs[tail & (URING_RECV_BUFS - 1)];
+    buf->addr = (uintptr_t)(ring.recv_bufs + bid * URING_RECV_LEN);
+    buf->len = URING_RECV_LEN;
+    buf->bid = bid;
+    __atomic_store_n(&ring.buf_ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void uring_post_recv() {
+
+    struct io_uring_sqe *sqe = uring_sqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock;
+    sqe->addr = (uintptr_t)&ring.recv_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = URING_RECV << 16;
+    uring_push();
+    ring.recv_armed = 1;
+}
+
+static void uring_post_send(int i) {
+
+    uring_send_t *s = &ring.send[i];
+    struct io_uring_sqe *sqe = uring_sqe();
+    sqe->fd = sock;
+    if (send_mode != URING_SENDMSG) {
+        // registered buffers are only accepted by the zero-copy send
+        // (whose slot is reusable once the notification is posted)
+        if (send_mode == URING_SEND_ZC) {
+            sqe->opcode = IORING_OP_SEND_ZC;
+            sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = 0;
+        }
+        else
+            sqe->opcode = IORING_OP_SEND;
+        sqe->addr = (uintptr_t)s->frame;
+        sqe->len = s->len;
+        sqe->addr2 = (uintptr_t)&s->addr;
+        sqe->addr_len = sizeof(s->addr);
+    }
+    else {
+        s->iov.iov_len = s->len;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = (uintptr_t)&s->msg;
+        sqe->len = 1;
+    }
+    sqe->user_data = (URING_SEND << 16) | i;
+    uring_push();
+}
+
+static void uring_send_done(struct io_uring_cqe *cqe) {
+
+    int i = cqe->user_data & 0xffff;
+
+    if (cqe->res == -EINVAL && send_mode < URING_SENDMSG && !(cqe->flags & IORING_CQE_F_NOTIF)) {
+        // send operation not supported by this kernel: the slot
+        // is sent again with the next one (after its notification)
+        send_mode = send_mode == URING_SEND_ZC ? URING_SEND_TO : URING_SENDMSG;
+        TRACE(TRACE_EVENT, "[NET] io_uring: send refused, falling back (%d).\n", send_mode);
+        if (cqe->flags & IORING_CQE_F_MORE)
+            ring.send[i].retry = 1;
+        else
+            uring_post_send(i);
+    }
+    else if (cqe->res < 0 && !(cqe->flags & IORING_CQE_F_NOTIF)) {
+        errno = -cqe->res;
+        perror("io_uring send error: ");
+        exit(1);
+    }
+    else if (cqe->flags & IORING_CQE_F_MORE)
+        ; // zero-copy send: the slot is still in use until notified
+    else if (ring.send[i].retry) {
+        ring.send[i].retry = 0;
+        uring_post_send(i);
+    }
+    else
+        ring.free_send[ring.num_free_send++] = i;
+}
+
+static void uring_recv_done(struct io_uring_cqe *cqe) {
+
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        ring.recv_armed = 0; // posted again once a buffer is free
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uring_recv_t *r = &ring.ready[(ring.ready_head + ring.ready_count++) % URING_RECV_BUFS];
+        r->bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        r->len = cqe->res;
+    }
+    else if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -EINTR) {
+        errno = -cqe->res;
+        perror("io_uring recvmsg error: ");
+        exit(1);
+    }
+    if (!ring.recv_armed && ring.ready_count < URING_RECV_BUFS)
+        uring_post_recv();
+}
+
+// Process the completions available in the CQ ring (no syscall)
+static void uring_reap() {
+
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        if ((cqe->user_data >> 16) == URING_RECV)
+            uring_recv_done(cqe);
+        else
+            uring_send_done(cqe);
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Frame and length of a received datagram (layout of a multishot receive)
+static paquet_t *uring_frame(uring_recv_t *r, int *len) {
+
+    struct io_uring_recvmsg_out *out = (void *)(ring.recv_bufs + r->bid * URING_RECV_LEN);
+    *len = out->payloadlen;
+    if (out->flags & MSG_TRUNC)
+        *len = -1;
+    return (paquet_t *)((unsigned char *)(out + 1) + ring.recv_msg.msg_namelen);
+}
+
+// Pop the datagram at the head of the ready queue, giving its buffer back
+static void uring_pop(paquet_t *packet, struct sockaddr_in *from) {
+
+    uring_recv_t *r = &ring.ready[ring.ready_head];
+    int len;
+    paquet_t *frame = uring_frame(r, &len);
+    if (packet != NULL) {
+        memcpy(packet, frame, len);
+        memcpy(from, (struct io_uring_recvmsg_out *)(ring.recv_bufs + r->bid * URING_RECV_LEN) + 1,
+               sizeof(*from));
+    }
+    uring_provide(r->bid);
+    ring.ready_head = (ring.ready_head + 1) % URING_RECV_BUFS;
+    ring.ready_count--;
+    if (!ring.recv_armed)
+        uring_post_recv(); // submitted with the next io_uring_enter
+}
+
+// Is a well-formed datagram waiting in the ready queue? Malformed
+// ones are dropped.
+static int uring_pending() {
+
+    uring_reap();
+    while (ring.ready_count > 0) {
+        int len;
+        paquet_t *frame = uring_frame(&ring.ready[ring.ready_head], &len);
+        if (valid_datagram(frame, len))
+            return 1;
+        uring_pop(NULL, NULL);
+    }
+    return 0;
+}
+
+// Queue the send of a frame to a remote address (submitted by the caller)
+static void uring_queue_send(paquet_t *frame, struct sockaddr_in *to) {
+
+    while (ring.num_free_send == 0) {
+        uring_submit(1);
+        uring_reap();
+    }
+    int i = ring.free_send[--ring.num_free_send];
+    ring.send[i].len = FRAME_LEN(frame);
+    memcpy(ring.send[i].frame, frame, ring.send[i].len);
+    ring.send[i].addr = *to;
+    uring_post_send(i);
+}
+
+// At exit, wait for the sends still in flight (last ACK, CON_CLOSE_ACK...)
+static void uring_drain() {
+
+    uring_reap();
+    while (ring.num_free_send < URING_SEND_SLOTS) {
+        uring_submit(1);
+        uring_reap();
+    }
+}
+
+// Create the ring, register the send pool and the receive buffer ring,
+// and post the receive. Returns the ring fd, or -1 if io_uring (5.19+
+// for the buffer ring) is not available.
+static int uring_init() {
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ring.fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (ring.fd < 0)
+        return -1;
+
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sq_len = cq_len = sq_len > cq_len ? sq_len : cq_len;
+    unsigned char *sq = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring.fd, IORING_OFF_SQ_RING);
+    unsigned char *cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+        cq = mmap(NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ring.fd, IORING_OFF_CQ_RING);
+    ring.sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    size_t send_len = URING_SEND_SLOTS * URING_SEND_LEN;
+    unsigned char *send_pool = mmap(NULL, send_len, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring.recv_bufs = mmap(NULL, URING_RECV_BUFS * URING_RECV_LEN, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring.buf_ring = mmap(NULL, URING_RECV_BUFS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || ring.sqes == MAP_FAILED ||
+        send_pool == MAP_FAILED || ring.recv_bufs == MAP_FAILED || ring.buf_ring == MAP_FAILED) {
+        close(ring.fd);
+        return -1;
+    }
+    ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring.sq_entries = p.sq_entries;
+    ring.cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // receive buffers, handed to the kernel through the buffer ring
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)ring.buf_ring;
+    reg.ring_entries = URING_RECV_BUFS;
+    reg.bgid = URING_BGID;
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        close(ring.fd);
+        return -1;
+    }
+    for (int bid = 0; bid < URING_RECV_BUFS; bid++)
+        uring_provide(bid);
+    ring.recv_msg.msg_namelen = sizeof(struct sockaddr_in);
+
+    // send pool, pinned once (may fail under a low RLIMIT_MEMLOCK)
+    struct iovec pool_iov = { send_pool, send_len };
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, &pool_iov, 1) < 0)
+        send_mode = URING_SEND_TO;
+    for (int i = 0; i < URING_SEND_SLOTS; i++) {
+        uring_send_t *s = &ring.send[i];
+        s->frame = (paquet_t *)(send_pool + i * URING_SEND_LEN);
+        s->iov.iov_base = s->frame;
+        s->msg.msg_name = &s->addr;
+        s->msg.msg_namelen = sizeof(s->addr);
+        s->msg.msg_iov = &s->iov;
+        s->msg.msg_iovlen = 1;
+        ring.free_send[i] = i;
+    }
+    ring.num_free_send = URING_SEND_SLOTS;
+
+    uring_post_recv();
+    uring_submit(0);
+    atexit(uring_drain);
+    return ring.fd;
+}
+
+// Earliest date attendre() has to wake up at: next timer, or next paced
+// frame (0: none)
+static long long next_deadline() {
+
+    long long deadline = num_timers > 0 ? timers[0].deadline : 0;
+    if (paced_count > 0 && (deadline == 0 || paced[paced_head].departure < deadline))
+        deadline = paced[paced_head].departure;
+    return deadline;
+}
+
+// Make the timerfd fire no later than the earliest timer (or paced frame).
+// It is only re-armed when that date is earlier than the armed date: a
+// timer stopped or restarted later (ACK received...) leaves it armed, and
+// the early wake-up that follows re-arms it, which saves a syscall per timer.
+static void arm_timerfd() {
+
+    long long deadline = next_deadline();
+    if (deadline == 0 || (armed_deadline != 0 && armed_deadline <= deadline))
+        return;
+    struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+    its.it_value.tv_sec = deadline / 1000000000LL;
+    its.it_value.tv_nsec = deadline % 1000000000LL;
+    if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        perror("timerfd_settime error: ");
+        exit(1);
+    }
+    armed_deadline = deadline;
+}
+
 /******************************************************************************
  * Attend un evenement et retourne :
  *    -1 si un paquet reçu est disponible
@@ -204,81 +1006,77 @@ void init_reseau_mode_reparti(int role, char *hote_distant) {
  *****************************************************************************/
 int attendre() {
 
-    int packet_received = 0;
-
     if (!net_initialized) {
         printf("[NET] ERROR, can't call \"attendre\" if network not initialized!\n");
         exit(1);
     }
 
-    // Monitor multiple file descriptors with select
-    // (only one here --> the socket)
-    fd_set rfds; // set of file descriptors
-    int nfds = sock + 1; // highest-numbered file descriptor, plus 1
+    struct epoll_event events[2];
 
-    struct timeval timeout;
-    struct timeval *ptimeout;
+    for (;;) {
+        // paced frames whose departure date has come
+        if (paced_count > 0)
+            pacing_flush(0);
 
-    while (!packet_received) {
-        // checking for any timeout
-        for (int i=0; i<num_timers; i++) {
-            if (timers[i].exp == 0) {
-                // found one!
-                int timer = timers[i].num_timer;
-                /* removing timer from array */
-                for (; i < num_timers - 1; i++) {
-                    timers[i] = timers[i+1];
-                }
-                num_timers--;
-                return timer; // return timer that has expired!
-            }
+        // checking for the earliest timeout
+        if (num_timers > 0 && timers[0].deadline <= now_ns()) {
+            int timer = timers[0].num_timer;
+            heap_remove(0);
+            return timer; // return timer that has expired!
         }
 
-        // reinit select timeout
-        // (man: "Consider timeout to be undefined after select() returns")
-        if (num_timers > 0) {
-            // if timmers are running, we block the select only 10ms
-            // to see if a packet has arrived
-            timeout.tv_sec = 0;
-            timeout.tv_usec = 10000; /* 10000 us = 10 ms */
-            // timeout.tv_usec = 100000; /* 100000 us = 100 ms */
-            ptimeout = &timeout;
+        // io_uring: completed receives are in the CQ ring
+        if (use_uring && uring_pending())
+            return -1; // packet_received
+
+        // edge-triggered: the socket is read until it is empty
+        // (a malformed datagram is dropped, the next one is checked)
+        while (sock_readable) {
+            int rep = check_pending_datagram();
+            if (rep > 0)
+                return -1; // packet_received
+            if (rep < 0)
+                sock_readable = 0;
         }
-        else
-            // no timers, block indefinitely waiting for a packet to arrive.
-            ptimeout = NULL;
-        
-        FD_ZERO(&rfds); // clearing set of file descriptors
-        FD_SET(sock, &rfds); // adding our socket fd to the set
-
-        /* Watching reading fd set (block for max timeout) */
-        int rep = select(nfds, &rfds, NULL, NULL, ptimeout);
-
-        switch (rep) {
-        case -1:
-            perror("select error: ");
+
+        // block until a datagram arrives or the timerfd fires
+        // (no timers: until a packet arrives)
+        arm_timerfd();
+        if (use_uring && ring.to_submit > 0)
+            uring_submit(0); // receive posted again
+        int n = epoll_wait(epfd, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait error: ");
             close(sock);
             exit(1);
-        case 0:
-            /* select() timeout has expired, no packet, we update the timers */
-            /* the timers are thus updated only when you call attendre() and
-             * when no packet has arrived! */
-            for (int i=0; i<num_timers; i++) {
-                if (timers[i].exp > 0) {
-                    timers[i].exp -= 10; // 10ms step
-                    if (timers[i].exp < 0)
-                        timers[i].exp = 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == sock)
+                sock_readable = 1;
+            else if (events[i].data.fd == tfd) {
+                // expired, the earliest timer is checked against the
+                // clock at the top of the loop
+                uint64_t expirations;
+                if (read(tfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+                    perror("timerfd read error: ");
+                    exit(1);
                 }
+                armed_deadline = 0;
             }
-            break;
-        default:
-            /* select success, check if socket is ready for reading */
-            if (FD_ISSET(sock, &rfds))
-                packet_received = 1;
         }
     }
-    // packet_received
-    return -1;
+}
+
+// Bookkeeping once a well-formed packet has been received from a remote address
+static void packet_received(paquet_t *packet, struct sockaddr_in *from) {
+
+    learn_address(packet, from);
+    /* last data packet? (an empty DATA packet marks the end of file) */
+    if (my_role == RECEIVER && packet->type == DATA && packet->lg_info == 0)
+        last_data_pkt = 1;
+    TRACE(TRACE_PACKET, "[NET] packet received.\n");
 }
 
 /*******************************************************************************
@@ -287,132 +1085,431 @@ int attendre() {
 void de_reseau(paquet_t *packet) {
 
     int data_len;
+    struct sockaddr_in from;
+    socklen_t from_len;
     if (!net_initialized) {
         printf("[NET] ERROR, can't call \"de_reseau\" if network not initialized!\n");
         exit(1);
     }
 
-    data_len = recvfrom(sock, (char *)packet, sizeof(paquet_t), 0, NULL, NULL);
-    if (data_len < 0) {
-        perror("recvfrom() error: ");
-        close(sock);
-        exit(1);
-    }
-
-    /* last data packet? */
-    if (my_role == RECEIVER && packet->lg_info < MAX_INFO) {
-        last_data_pkt = 1;
+    // only a datagram whose length matches its header is returned
+    if (use_uring) {
+        while (!uring_pending())
+            uring_submit(1);
+        uring_pop(packet, &from);
     }
-
-    printf("[NET] packet received.\n");
+    else do {
+        from_len = sizeof(from);
+        data_len = recvfrom(sock, (char *)packet, sizeof(paquet_t), 0,
+                            (struct sockaddr *)&from, &from_len);
+        if (data_len < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("recvfrom() error: ");
+            close(sock);
+            exit(1);
+        }
+    } while (!valid_datagram(packet, data_len));
+    packet_received(packet, &from);
 }
 
 /*******************************************************************************
- * Envoie un paquet de type paquet_t
+ * Recoit tous les paquets disponibles (au plus max) avec un seul appel
+ * systeme (recvmmsg). Bloquant tant qu'aucun paquet n'est recu.
+ * Retourne le nombre de paquets recus.
  ******************************************************************************/
-void vers_reseau(paquet_t *packet) {
+int de_reseau_lot(paquet_t packets[], int max) {
+
+    struct mmsghdr msgs[MAX_BATCH];
+    struct iovec iovs[MAX_BATCH];
+    struct sockaddr_in from[MAX_BATCH];
+    int nb_packets = 0;
 
     if (!net_initialized) {
-        printf("[NET] ERROR, can't call \"vers_reseau\" if network not initialized!\n");
+        printf("[NET] ERROR, can't call \"de_reseau_lot\" if network not initialized!\n");
         exit(1);
     }
+    if (max > MAX_BATCH)
+        max = MAX_BATCH;
+
+    if (use_uring) {
+        while (!uring_pending())
+            uring_submit(1);
+        do {
+            uring_pop(&packets[nb_packets], &from[0]);
+            packet_received(&packets[nb_packets], &from[0]);
+            nb_packets++;
+        } while (nb_packets < max && uring_pending());
+        return nb_packets;
+    }
+
+    while (nb_packets == 0) {
+        for (int i = 0; i < max; i++) {
+            iovs[i].iov_base = &packets[i];
+            iovs[i].iov_len = sizeof(paquet_t);
+            memset(&msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        // block for the first datagram only, then drain what is pending
+        int rep = recvmmsg(sock, msgs, max, MSG_WAITFORONE, NULL);
+        if (rep < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("recvmmsg() error: ");
+            close(sock);
+            exit(1);
+        }
+        // keep only well-formed packets, in arrival order
+        for (int i = 0; i < rep; i++) {
+            if (!valid_datagram(&packets[i], msgs[i].msg_len))
+                continue;
+            if (nb_packets != i)
+                memcpy(&packets[nb_packets], &packets[i], FRAME_LEN(&packets[i]));
+            packet_received(&packets[nb_packets], &from[i]);
+            nb_packets++;
+        }
+    }
+    return nb_packets;
+}
+
+// Apply the loss/error model to a packet about to be sent.
+// Returns the frame to put on the wire: the caller's packet itself, or
+// a corrupted copy in scratch frame number slot (0 <= slot < MAX_BATCH)
+// if an error is drawn. Returns NULL if the packet is lost.
+static paquet_t *prepare_packet(paquet_t *packet, int slot) {
 
     /* loss connection request? */
     if (packet->type == CON_REQ && nl_conf.loss_connect) {
-        printf("%s[NET] loss CON_REQ packet%s\n", RED, NRM);
+        TRACE(TRACE_EVENT, "%s[NET] loss CON_REQ packet%s\n", RED, NRM);
         nl_conf.loss_connect = 0; /* discard packet only one time */
-        return;
+        return NULL;
     }
 
     /* loss connection response? */
     if (packet->type == CON_ACCEPT && nl_conf.loss_connect) {
-        printf("%s[NET] loss CON_ACCEPT packet%s\n", RED, NRM);
+        TRACE(TRACE_EVENT, "%s[NET] loss CON_ACCEPT packet%s\n", RED, NRM);
         nl_conf.loss_connect = 0; /* discard packet only one time */
-        return;
+        return NULL;
     }
 
     /* loss disconnection? */
     if (packet->type == CON_CLOSE && nl_conf.loss_disconnect) {
-        printf("%s[NET] loss CON_CLOSE packet%s\n", RED, NRM);
+        TRACE(TRACE_EVENT, "%s[NET] loss CON_CLOSE packet%s\n", RED, NRM);
         nl_conf.loss_disconnect = 0; /* discard packet only one time */
-        return;
+        return NULL;
     }
 
     /* loss disconnection ack? */
     if (packet->type == CON_CLOSE_ACK && nl_conf.loss_disconnect) {
-        printf("%s[NET] loss CON_CLOSE_ACK packet%s\n", RED, NRM);
+        TRACE(TRACE_EVENT, "%s[NET] loss CON_CLOSE_ACK packet%s\n", RED, NRM);
         nl_conf.loss_disconnect = 0; /* discard packet only one time */
-        return;
+        return NULL;
     }
 
     /* loss last ack? */
     if (packet->type == ACK && last_data_pkt && nl_conf.loss_last_ack) {
-        printf("%s[NET] loss LAST ACK%s\n", RED, NRM);
+        TRACE(TRACE_EVENT, "%s[NET] loss LAST ACK%s\n", RED, NRM);
         nl_conf.loss_last_ack = 0; /* discard packet only one time */
-        return;
+        return NULL;
     }
 
     /* loss? */
     if (rand() / (float)RAND_MAX < nl_conf.loss_proba) {
-        printf("%s[NET] packet loss!%s\n", RED, NRM);
-        packet_loss_count++; /* update loss count for perf eval */
-        return;
+        TRACE(TRACE_EVENT, "%s[NET] packet loss!%s\n", RED, NRM);
+        perf_add(&perf.losses, 1); /* update loss count for perf eval */
+        return NULL;
     }
 
-    // copy packet (mandatory to generate errors and
-    //              be able to retransmit the original packet)
-    paquet_t *new_packet;
-    new_packet = malloc(sizeof(paquet_t));
-    memcpy(new_packet, packet, sizeof(paquet_t));
-
     /* error? */
     if (rand() / (float)RAND_MAX < nl_conf.error_proba) {
-        printf("%s[NET] generating error in packet!%s\n", RED, NRM);
-        if (packet->lg_info > 0 && packet->lg_info <= MAX_INFO) {
+        // copy packet (mandatory to generate errors and
+        //              be able to retransmit the original packet)
+        // (only the header and the lg_info used bytes go on the wire)
+        paquet_t *new_packet = &scratch_frames[slot];
+        memcpy(new_packet, packet, FRAME_LEN(packet));
+        TRACE(TRACE_EVENT, "%s[NET] generating error in packet!%s\n", RED, NRM);
+        if (packet->lg_info > 0 && nl_conf.error_bits > 0) {
+            /* BITS_ERREUR bits flipped in the same bit column of
+             * distinct data bytes (cancel out in a XOR/parity sum) */
+            int n = nl_conf.error_bits < packet->lg_info ? nl_conf.error_bits : packet->lg_info;
+            int step = packet->lg_info / n;
+            int r = rand() % packet->lg_info;
+            uint8_t mask = 1 << (rand() % 8);
+            for (int k = 0; k < n; k++)
+                new_packet->info[(r + k * step) % packet->lg_info] ^= mask;
+        }
+        else if (packet->lg_info > 0 && packet->lg_info <= MAX_INFO) {
             int r = rand() % packet->lg_info;
             /* ones' complement of a random data byte */
             new_packet->info[r] = ~(new_packet->info[r]);
         }
         else
             new_packet->num_seq++;
+        return new_packet;
     }
+    // no error: the caller's packet is sent as is
+    return packet;
+}
 
-    // init remote server addr
-    struct sockaddr_in dst_addr;
-    dst_addr.sin_family = AF_INET;
-    dst_addr.sin_port = htons(remote_port()); /* htons: host to net byte order (short int) */
-    inet_pton(AF_INET, remote_ipv4, &(dst_addr.sin_addr));
-    // TODO. check "localhost" with inet_pton...
-    int addr_len = sizeof(dst_addr);
+// Bookkeeping once a frame returned by prepare_packet() has been sent
+static void packet_sent(paquet_t *new_packet) {
+
+    perf_add(&perf.packets, 1); /* update packet count for perf eval */
+    perf_add(&perf.bytes, new_packet->lg_info);
+    TRACE(TRACE_PACKET, "[NET] packet sent.\n");
+    // printf("(to remote @ %s and remote port %d)\n", remote_ipv4, remote_port());
+    // check if last packet (empty DATA packet or connection close = end of file)
+    if (my_role == SENDER && !atomic_load_explicit(&perf.end, memory_order_relaxed) &&
+        ((new_packet->type == DATA && new_packet->lg_info == 0) ||
+         new_packet->type == CON_CLOSE)) {
+        // stop perf eval thread
+        atomic_store_explicit(&perf.end, 1, memory_order_release);
+        // wait to make sure performace thread finished (and wrote perf.txt)
+        if (nl_conf.plot_period_ms != 0)
+            pthread_join(perf_thid, NULL);
+    }
+}
+
+// Send one frame; departure > 0: date (ns) at which the kernel sends it
+// (SO_TXTIME)
+static void send_frame(paquet_t *frame, struct sockaddr_in *to, long long departure) {
+
+    if (use_uring) {
+        uring_queue_send(frame, to);
+        uring_submit(0);
+        packet_sent(frame);
+        return;
+    }
+
+    struct iovec iov = { .iov_base = frame, .iov_len = FRAME_LEN(frame) };
+    struct msghdr msg = { .msg_name = to, .msg_namelen = sizeof(*to),
+                          .msg_iov = &iov, .msg_iovlen = 1 };
+#ifdef SO_TXTIME
+    char control[CMSG_SPACE(sizeof(uint64_t))];
+    if (departure > 0) {
+        uint64_t txtime = departure;
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(txtime));
+        memcpy(CMSG_DATA(cmsg), &txtime, sizeof(txtime));
+    }
+#else
+    (void)departure;
+#endif
+    while (sendmsg(sock, &msg, 0) < 0) {
+        if (errno == EINTR)
+            continue;
+        perror("sendmsg error: ");
+        close(sock);
+        exit(1);
+    }
+    packet_sent(frame);
+}
+
+// Departure date (ns) of a frame of len bytes, its tokens taken from the
+// bucket: 0 if the bucket holds enough, the frame leaves at once
+static long long pacing_departure(int len) {
+
+    long long now = now_ns();
+    double depth = (double)pacing_rate * PACING_QUANTUM_US / 1e6;
+
+    if (depth < PACING_BURST * (HEADER_LEN + nl_conf.info_size))
+        depth = PACING_BURST * (HEADER_LEN + nl_conf.info_size);
+    pacing_tokens += (now - pacing_refill) * (double)pacing_rate / 1e9;
+    if (pacing_tokens > depth)
+        pacing_tokens = depth;
+    pacing_refill = now;
+    pacing_tokens -= len;
+    if (pacing_tokens >= 0)
+        return 0;
+    return now + (long long)(-pacing_tokens * 1e9 / pacing_rate);
+}
+
+// Send a frame at the pace of the token bucket
+static void pacing_send(paquet_t *frame, struct sockaddr_in *to) {
+
+    long long departure = pacing_departure(FRAME_LEN(frame));
+
+    pacing_last = departure;
+    if (use_txtime) {
+        send_frame(frame, to, departure);
+        return;
+    }
+    // frames held back go first
+    if (departure == 0 && paced_count == 0) {
+        send_frame(frame, to, 0);
+        return;
+    }
+    // timer-driven fallback: the frame is copied (the caller may reuse
+    // it, scratch frames are) and sent from attendre() at its date
+    if (paced_count == PACING_QUEUE)
+        pacing_flush(1);
+    paced_frame_t *p = &paced[(paced_head + paced_count) % PACING_QUEUE];
+    p->departure = departure;
+    p->to = *to;
+    memcpy(&p->frame, frame, FRAME_LEN(frame));
+    paced_count++;
+}
+
+// Send the held back frames whose departure date has come (wait: after
+// sleeping until the first one can leave)
+static void pacing_flush(int wait) {
+
+    if (wait && paced_count > 0) {
+        long long departure = paced[paced_head].departure;
+        struct timespec ts = { departure / 1000000000LL, departure % 1000000000LL };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+    }
+    long long now = now_ns();
+    while (paced_count > 0 && paced[paced_head].departure <= now) {
+        send_frame(&paced[paced_head].frame, &paced[paced_head].to, 0);
+        paced_head = (paced_head + 1) % PACING_QUEUE;
+        paced_count--;
+    }
+}
+
+// At exit, send the frames still held back (last ACK, CON_CLOSE...)
+static void pacing_drain() {
+
+    while (paced_count > 0)
+        pacing_flush(1);
+}
+
+/****************************************************************
+ * Débit de l'émetteur (RYTHME_EMISSION auto) : fenêtre (en     *
+ * paquets) par RTT lissé, avec une marge                       *
+ ****************************************************************/
+void rythme_emission(double fenetre, long srtt_us) {
+
+    if (nl_conf.pacing_rate != PACING_AUTO || srtt_us <= 0)
+        return;
+    pacing_rate = PACING_GAIN * fenetre * (HEADER_LEN + nl_conf.info_size) * 1e6 / srtt_us;
+}
+
+/*******************************************************************************
+ * Envoie un paquet de type paquet_t
+ ******************************************************************************/
+void vers_reseau(paquet_t *packet) {
+
+    if (!net_initialized) {
+        printf("[NET] ERROR, can't call \"vers_reseau\" if network not initialized!\n");
+        exit(1);
+    }
+
+    paquet_t *new_packet = prepare_packet(packet, 0);
+    if (new_packet == NULL)
+        return; // lost
+
+    if (pacing_rate > 0 || paced_count > 0) {
+        pacing_send(new_packet, destination(packet));
+        return;
+    }
+
+    if (use_uring) {
+        uring_queue_send(new_packet, destination(packet));
+        uring_submit(0);
+        packet_sent(new_packet);
+        return;
+    }
 
     int data_len = sendto(
         sock,
-        (char *)new_packet, sizeof(paquet_t), 0,
-        (struct sockaddr *)&dst_addr, addr_len);
+        (char *)new_packet, FRAME_LEN(new_packet), 0,
+        (struct sockaddr *)destination(packet), sizeof(dst_addr));
 
     if (data_len < 0) {
         perror("sendto error: ");
         close(sock);
         exit(1);
     }
-    sent_packet_count++; /* update packet count for perf eval */
-    printf("[NET] packet sent.\n");
-    // printf("(to remote @ %s and remote port %d)\n", remote_ipv4, remote_port());
-    // check if last packet 
-    if (my_role == SENDER && new_packet->lg_info < MAX_INFO) {
-        // stop perf eval thread
-        end_communication = 1;
-        // wait to make sure performace thread finished (and wrote perf.txt)
-        pthread_join(perf_thid, NULL);        
+    packet_sent(new_packet);
+}
+
+/*******************************************************************************
+ * Envoie n paquets de type paquet_t avec un seul appel systeme (sendmmsg).
+ * Chaque paquet subit les memes pertes/erreurs que dans vers_reseau().
+ ******************************************************************************/
+void vers_reseau_lot(paquet_t *packets[], int n) {
+
+    struct mmsghdr msgs[MAX_BATCH];
+    struct iovec iovs[MAX_BATCH];
+    paquet_t *frames[MAX_BATCH];
+
+    if (!net_initialized) {
+        printf("[NET] ERROR, can't call \"vers_reseau_lot\" if network not initialized!\n");
+        exit(1);
+    }
+
+    if (pacing_rate > 0 || paced_count > 0) {
+        // paced: frames leave one by one
+        for (int i = 0; i < n; i++) {
+            paquet_t *new_packet = prepare_packet(packets[i], 0);
+            if (new_packet != NULL)
+                pacing_send(new_packet, destination(packets[i]));
+        }
+        return;
+    }
+
+    if (use_uring) {
+        // frames copied in the pool: one io_uring_enter for the batch
+        for (int i = 0; i < n; i++) {
+            paquet_t *new_packet = prepare_packet(packets[i], 0);
+            if (new_packet == NULL)
+                continue; // lost
+            uring_queue_send(new_packet, destination(packets[i]));
+            packet_sent(new_packet);
+        }
+        uring_submit(0);
+        return;
+    }
+
+    for (int first = 0; first < n; first += MAX_BATCH) {
+        int nb_frames = 0;
+        for (int i = first; i < n && i < first + MAX_BATCH; i++) {
+            paquet_t *new_packet = prepare_packet(packets[i], nb_frames);
+            if (new_packet == NULL)
+                continue; // lost
+            frames[nb_frames] = new_packet;
+            iovs[nb_frames].iov_base = new_packet;
+            iovs[nb_frames].iov_len = FRAME_LEN(new_packet);
+            memset(&msgs[nb_frames].msg_hdr, 0, sizeof(struct msghdr));
+            msgs[nb_frames].msg_hdr.msg_name = destination(packets[i]);
+            msgs[nb_frames].msg_hdr.msg_namelen = sizeof(dst_addr);
+            msgs[nb_frames].msg_hdr.msg_iov = &iovs[nb_frames];
+            msgs[nb_frames].msg_hdr.msg_iovlen = 1;
+            nb_frames++;
+        }
+
+        // sendmmsg may send less than requested: loop on the remaining ones
+        for (int sent = 0; sent < nb_frames; ) {
+            int rep = sendmmsg(sock, msgs + sent, nb_frames - sent, 0);
+            if (rep < 0) {
+                if (errno == EINTR)
+                    continue;
+                perror("sendmmsg error: ");
+                close(sock);
+                exit(1);
+            }
+            sent += rep;
+        }
+        for (int i = 0; i < nb_frames; i++)
+            packet_sent(frames[i]);
     }
-    free(new_packet);
 }
 
 /**************************************************************************
- * Demarre le timer numero n (0 <= n <= NBR_MAX_TIMERS-1) qui s'arrete    *
- * apres ms millisecondes (ms doit etre un multiple de 50)                *
+ * Demarre le timer numero n (0 <= n <= MAX_TIMERS-1) qui s'arrete        *
+ * apres us microsecondes                                                 *
  **************************************************************************/
-void depart_temporisateur_num(int n, int ms) {
+void depart_temporisateur_num_us(int n, long us) {
 
     if (n < 0 || n > MAX_TIMERS - 1) {
         printf("%s[NET] Timer number %d is incorrect.%s\n", RED, n, NRM);
@@ -420,16 +1517,39 @@ void depart_temporisateur_num(int n, int ms) {
     }
 
     /* lookup if timer already in use */
-    for (int i=0; i < num_timers; i++)
-        if (timers[i].num_timer == n) {
-            printf("%s[NET] Can't start timer %d, it is already running.%s\n", RED, n, NRM);
-            return;
-        }
+    if (timer_pos[n]) {
+        printf("%s[NET] Can't start timer %d, it is already running.%s\n", RED, n, NRM);
+        return;
+    }
 
     /* ok, it's not already used */
+    /* paced sender: a timer started once a frame has been handed over
+     * runs from the date the frame actually leaves (no spurious timeout
+     * while it is held back) */
+    long long start = now_ns();
+    if (pacing_last > start)
+        start = pacing_last;
     timers[num_timers].num_timer = n;
-    timers[num_timers].exp = ms;
+    timers[num_timers].deadline = start + (long long)us * 1000LL;
     num_timers++;
+    heap_sift_up(num_timers - 1);
+}
+
+/**************************************************************************
+ * Demarre le timer numero n (0 <= n <= MAX_TIMERS-1) qui s'arrete        *
+ * apres ms millisecondes                                                 *
+ **************************************************************************/
+void depart_temporisateur_num(int n, int ms) {
+
+    depart_temporisateur_num_us(n, (long)ms * 1000L);
+}
+
+/*********************************************************
+ * Horloge monotone (us)                                 *
+ *********************************************************/
+long long horloge_us() {
+
+    return now_ns() / 1000;
 }
 
 /*********************************************************
@@ -439,11 +1559,9 @@ void depart_temporisateur_num(int n, int ms) {
  *********************************************************/
 int test_temporisateur(int n) {
 
-    for (int i = 0; i < num_timers; i++) {
-        if (timers[i].num_timer == n)
-            return 1;
-    }
-    return 0;
+    if (n < 0 || n > MAX_TIMERS - 1)
+        return 0;
+    return timer_pos[n] != 0;
 }
 
 /****************************
@@ -456,21 +1574,12 @@ void arret_temporisateur_num(int n) {
         return;
     }
 
-    /* lookup for the timer */
-    int i;
-    for (i = 0; i < num_timers; i++) {
-        if (timers[i].num_timer == n) {
-            /* deleting timer */
-            for (; i < num_timers - 1; i++) {
-                timers[i] = timers[i + 1];
-            }
-            num_timers--;
-            return;
-        }
+    if (!timer_pos[n]) {
+        printf("%s[NET] Can't stop timer %d, it is not started!%s\n", RED, n, NRM);
+        return;
     }
 
-    if (i == num_timers)
-        printf("%s[NET] Can't stop timer %d, it is not started!%s\n", RED, n, NRM);
+    heap_remove(timer_pos[n] - 1);
 }
 
 void depart_temporisateur(int ms) {
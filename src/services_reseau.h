@@ -23,6 +23,13 @@
 /* pour attendre() */
 #define PAQUET_RECU -1
 
+/* Numéros de temporisateur : 0 à MAX_TEMPORISATEURS-1
+ * (deux par connexion d'un récepteur en mode connecté) */
+#define MAX_TEMPORISATEURS 128
+
+/* Connexions simultanées d'un récepteur en mode connecté */
+#define MAX_CONNEXIONS 64
+
 /* ============================ */
 /* Initialisation couche réseau */
 /* ============================ */
@@ -41,6 +48,13 @@ void init_reseau(int role);
  **********************************************************************/
 void init_reseau_mode_reparti(int role, char *hote_distant);
 
+/**********************************************************************
+ * Transfert sur plusieurs flux (un processus par flux) : le flux     *
+ * numéro flux utilise les ports de base + 2 x flux, des deux côtés.  *
+ * A appeler avant l'initialisation.                                  *
+ **********************************************************************/
+void choisir_flux(int flux);
+
 
 /* ================================================= */
 /* Primitives de service pour émission et réception  */
@@ -58,21 +72,52 @@ void vers_reseau(paquet_t *paquet);
  ***********************************************************/
 void de_reseau(paquet_t *paquet);
 
+/***********************************************************
+ * Remet n paquets à la couche réseau en un seul appel     *
+ * système (mêmes pertes/erreurs que vers_reseau()).       *
+ ***********************************************************/
+void vers_reseau_lot(paquet_t *paquets[], int n);
+
+/***********************************************************
+ * Prélève tous les paquets disponibles, au plus max (<=64) *
+ * en un seul appel système (N.B. : fonction bloquante      *
+ * tant qu'aucun paquet n'est reçu).                        *
+ * Retour : nombre de paquets reçus dans paquets[]          *
+ ***********************************************************/
+int de_reseau_lot(paquet_t paquets[], int max);
+
+/***********************************************************
+ * Mode connecté, plusieurs émetteurs pour un récepteur :  *
+ * l'adresse de chaque émetteur est apprise à la réception *
+ * de son CON_REQ, et les paquets portant son id_con lui   *
+ * sont envoyés (les autres vont à l'hôte distant fixé à   *
+ * l'initialisation). Libère l'adresse de la connexion     *
+ * id_con, une fois celle-ci terminée.                     *
+ ***********************************************************/
+void oublier_connexion(uint32_t id_con);
+
 /* ======================================================= */
 /* Fonctions utilitaires pour la gestion de temporisateurs */
 /* ======================================================= */
 
 /***********************************************************************
- * Démarre le temporisateur numéro n (0 <= n <= 31), qui s'arrêtera    *
- * après ms millisecondes (ms doit être un multiple de 10)             *
- * Valeur minimale : 20 ms (valeur conseillée en salle de TP : 100 ms) *
+ * Démarre le temporisateur numéro n (0 <= n < MAX_TEMPORISATEURS),    *
+ * qui s'arrêtera après ms millisecondes (résolution : 1 ms, horloge   *
+ * monotone)                                                           *
+ * (valeur conseillée en salle de TP : 100 ms)                         *
  ***********************************************************************/
 void depart_temporisateur_num(int n, int ms);
 
+/***********************************************************************
+ * Démarre le temporisateur numéro n (0 <= n < MAX_TEMPORISATEURS),    *
+ * qui s'arrêtera après us microsecondes (pour les temporisations      *
+ * inférieures à la milliseconde, ex. RTO adaptatif en local)          *
+ ***********************************************************************/
+void depart_temporisateur_num_us(int n, long us);
+
 /***********************************************************************
  * Démarre un temporisateur qui s'arrêtera après ms millisecondes.     *
- * Valeur minimale : 20 ms (valeur conseillée en salle de TP : 100 ms) *
- * (dans tous les cas ms doit être un multiple de 10)                  *
+ * (résolution : 1 ms, valeur conseillée en salle de TP : 100 ms)      *
  ***********************************************************************/
 void depart_temporisateur(int ms);
 
@@ -94,4 +139,27 @@ void arret_temporisateur();
  ****************************************************************/
 int attendre();
 
+/****************************************************************
+ * Horloge monotone en microsecondes (mesure de RTT...)         *
+ ****************************************************************/
+long long horloge_us();
+
+/****************************************************************
+ * Télémétrie de l'émetteur (PERIODE_CALCUL_DEBIT) : paquets    *
+ * réémis, mesures de RTT (us), paquets en vol et fenêtre de    *
+ * congestion, écrits avec le débit et les pertes dans perf.txt *
+ * au fil du transfert                                          *
+ ****************************************************************/
+void perf_reemission();
+void perf_rtt(long rtt_us);
+void perf_fenetre(int en_vol);
+void perf_cwnd(double cwnd);
+
+/****************************************************************
+ * Rythme d'émission (RYTHME_EMISSION auto) : les paquets sont  *
+ * espacés pour ne pas dépasser fenetre paquets par RTT lissé   *
+ * (srtt_us), au lieu de partir en rafale                       *
+ ****************************************************************/
+void rythme_emission(double fenetre, long srtt_us);
+
 #endif
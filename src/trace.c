@@ -0,0 +1,144 @@
+/********************************************************************
+ *         Leveled, buffered tracing                                *
+ *                                                                  *
+ * Bounded multi-producer ring (one sequence number per slot, all   *
+ * zero at start so tracing works before trace_init()):             *
+ * producers claim a slot with a CAS on 'head', fill it and publish *
+ * it by bumping its sequence number; the flushing thread is the    *
+ * only consumer.                                                   *
+ ********************************************************************/
+
+#include "config.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RING_SIZE 4096 /* power of two */
+#define LINE_MAX_LEN 128
+#define FLUSH_PERIOD_NS 1000000 /* 1 ms when the ring is empty */
+
+typedef struct trace_slot_s {
+    atomic_size_t seq; /* 2*lap: free, 2*lap + 1: ready (lap = pos / RING_SIZE) */
+    int len;
+    char line[LINE_MAX_LEN];
+} trace_slot_t;
+
+int trace_level = TRACE_EVENT;
+
+static trace_slot_t ring[RING_SIZE];
+static atomic_size_t head;    /* next position claimed by a producer */
+static size_t tail;           /* next position flushed (consumer only) */
+static atomic_uint dropped;   /* lines lost because the ring was full */
+static atomic_int running;
+static pthread_t flusher;
+
+void trace_write(const char *fmt, ...)
+{
+    size_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+    trace_slot_t *slot;
+    va_list ap;
+    int len;
+
+    for (;;) {
+        slot = &ring[pos & (RING_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(2 * (pos / RING_SIZE));
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            /* full: never wait on the data path */
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        }
+        else {
+            pos = atomic_load_explicit(&head, memory_order_relaxed);
+        }
+    }
+
+    va_start(ap, fmt);
+    len = vsnprintf(slot->line, LINE_MAX_LEN, fmt, ap);
+    va_end(ap);
+    if (len < 0)
+        len = 0;
+    if (len >= LINE_MAX_LEN) {
+        len = LINE_MAX_LEN - 1;
+        slot->line[len - 1] = '\n';
+    }
+    slot->len = len;
+
+    atomic_store_explicit(&slot->seq, 2 * (pos / RING_SIZE) + 1, memory_order_release);
+}
+
+/* Writes out every published line, returns how many */
+static int drain()
+{
+    int n = 0;
+    unsigned int lost;
+
+    for (;;) {
+        trace_slot_t *slot = &ring[tail & (RING_SIZE - 1)];
+        size_t lap = tail / RING_SIZE;
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != 2 * lap + 1)
+            break;
+        fwrite(slot->line, 1, slot->len, stdout);
+        atomic_store_explicit(&slot->seq, 2 * lap + 2, memory_order_release);
+        tail++;
+        n++;
+    }
+
+    lost = atomic_exchange_explicit(&dropped, 0, memory_order_relaxed);
+    if (lost)
+        printf("[TRACE] %u lines dropped (ring full).\n", lost);
+    if (n || lost)
+        fflush(stdout);
+    return n;
+}
+
+static void *flush_loop(void *arg)
+{
+    struct timespec period = { 0, FLUSH_PERIOD_NS };
+
+    while (atomic_load(&running)) {
+        if (drain() == 0)
+            nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+static void trace_stop()
+{
+    if (atomic_exchange(&running, 0))
+        pthread_join(flusher, NULL);
+    drain();
+}
+
+void trace_init()
+{
+    static int done = 0;
+
+    if (done)
+        return;
+    done = 1;
+
+    trace_level = conf_trace_level();
+
+    atexit(trace_stop);
+    if (trace_level == TRACE_OFF || TRACE_MAX == TRACE_OFF)
+        return;
+
+    atomic_store(&running, 1);
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) != 0) {
+        perror("[TRACE] pthread_create");
+        atomic_store(&running, 0);
+    }
+}
@@ -0,0 +1,44 @@
+/********************************************************************
+ *         Leveled, buffered tracing                                *
+ *                                                                  *
+ * TRACE(level, fmt, ...) formats a line into a lock-free ring      *
+ * buffer; a background thread writes the ring to stdout, so the    *
+ * data path never blocks on terminal or log file I/O.              *
+ *                                                                  *
+ * Two filters:                                                     *
+ *  - TRACE_MAX (compile time, e.g. make tdd4 TRACE_MAX=0): calls   *
+ *    above it are removed by the compiler,                         *
+ *  - NIVEAU_TRACE (config.txt, run time): calls above it cost a    *
+ *    single test, their arguments are not evaluated.               *
+ ********************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#define TRACE_OFF    0
+#define TRACE_ERROR  1 /* unexpected conditions */
+#define TRACE_EVENT  2 /* losses, injected errors, end of file... */
+#define TRACE_PACKET 3 /* one line per packet or chunk */
+
+#ifndef TRACE_MAX
+#define TRACE_MAX TRACE_PACKET
+#endif
+
+/* Run time level (NIVEAU_TRACE, TRACE_EVENT by default) */
+extern int trace_level;
+
+#define TRACE(level, ...)                                        \
+    do {                                                         \
+        if ((level) <= TRACE_MAX && (level) <= trace_level)      \
+            trace_write(__VA_ARGS__);                            \
+    } while (0)
+
+/* Reads the run time level and starts the flushing thread;
+ * the ring is drained once more at exit. */
+void trace_init();
+
+/* Appends one formatted line to the ring (dropped if it is full);
+ * may be called from any thread. */
+void trace_write(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif
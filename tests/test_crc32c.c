@@ -0,0 +1,151 @@
+/*************************************************************
+* Test unitaire du CRC32C (make check)                       *
+*                                                            *
+*  - valeur de contrôle standard de "123456789"              *
+*  - accord des implémentations SSE4.2 et slicing-by-8       *
+*  - détection des erreurs multi-bits de BITS_ERREUR (bits   *
+*    d'une même colonne dans des octets distincts, cf.       *
+*    services_reseau.c), y compris après modifier_entete()   *
+*                                                            *
+* crc32c.c est inclus pour accéder aux deux implémentations. *
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/crc32c.c"
+#include "../src/couche_transport.h"
+
+#define NB_ESSAIS 20000
+
+static int echecs = 0;
+
+#define VERIFIER(cond, ...) do { \
+        if (!(cond)) { printf("ECHEC : " __VA_ARGS__); printf("\n"); echecs++; } \
+    } while (0)
+
+static paquet_t paquet, copie;
+
+static void remplir(unsigned char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = rand();
+}
+
+/* Erreur injectée par la couche réseau (BITS_ERREUR n) : n bits inversés
+ * dans la même colonne d'octets de données distincts */
+static void inverser_bits(paquet_t *p, int n)
+{
+    int pas = p->lg_info / n;
+    int r = rand() % p->lg_info;
+    uint8_t masque = 1 << (rand() % 8);
+
+    for (int k = 0; k < n; k++)
+        p->info[(r + k * pas) % p->lg_info] ^= masque;
+}
+
+static void test_valeur_controle()
+{
+    uint32_t crc = crc32c(0, "123456789", 9);
+
+    VERIFIER(crc == 0xE3069283, "CRC32C(\"123456789\") = %08x", crc);
+    /* calcul enchaîné */
+    crc = crc32c(crc32c(0, "1234", 4), "56789", 5);
+    VERIFIER(crc == 0xE3069283, "CRC32C enchaîné = %08x", crc);
+}
+
+static void test_implementations()
+{
+    static unsigned char buf[4096 + 8];
+
+    crc32c_materiel(); /* tables construites */
+#ifdef CRC32C_SSE42
+    if (!__builtin_cpu_supports("sse4.2")) {
+        printf("(pas de SSE4.2 : comparaison ignorée)\n");
+        return;
+    }
+    remplir(buf, sizeof(buf));
+    /* longueurs et alignements variés, registre initial quelconque */
+    for (size_t len = 0; len <= 4096; len += (len < 64 ? 1 : 61))
+        for (int decalage = 0; decalage < 8; decalage++) {
+            uint32_t init = rand();
+            uint32_t a = crc32c_sse42(init, buf + decalage, len);
+            uint32_t b = crc32c_slicing8(init, buf + decalage, len);
+            VERIFIER(a == b, "SSE4.2 %08x != slicing-by-8 %08x (%zu octets)", a, b, len);
+        }
+#else
+    (void)buf;
+    printf("(pas de SSE4.2 sur cette architecture : comparaison ignorée)\n");
+#endif
+}
+
+/* Paquet de lg_info octets aléatoires, somme de contrôle à jour */
+static void paquet_aleatoire(int lg_info)
+{
+    memset(&paquet, 0, offsetof(paquet_t, info));
+    paquet.type = DATA;
+    paquet.num_seq = rand() % SEQ_NUM_SIZE;
+    paquet.lg_info = lg_info;
+    remplir(paquet.info, lg_info);
+    paquet.somme_ctrl = generer_controle(&paquet);
+}
+
+static void test_erreurs_multibits()
+{
+    /* distance de Hamming 6 sur 124 octets : 1 à 5 bits toujours
+     * détectés ; au-delà, et sur des paquets plus longs, une erreur
+     * passe avec une probabilité de 2^-32 */
+    int tailles[] = { TAILLE_INFO_DEFAUT, 1400, MAX_INFO };
+
+    choisir_controle(CTRL_CRC32C);
+    for (int t = 0; t < 3; t++)
+        for (int n = 1; n <= 8; n++) {
+            int non_detectees = 0;
+            int essais = tailles[t] == MAX_INFO ? NB_ESSAIS / 100 : NB_ESSAIS;
+            for (int i = 0; i < essais; i++) {
+                paquet_aleatoire(tailles[t]);
+                inverser_bits(&paquet, n);
+                if (verifier_controle(&paquet))
+                    non_detectees++;
+            }
+            VERIFIER(non_detectees == 0, "%d erreurs de %d bits non detectees (%d octets)",
+                     non_detectees, n, tailles[t]);
+        }
+}
+
+static void test_modifier_entete()
+{
+    int controles[] = { CTRL_CRC32C, CTRL_INTERNET };
+
+    for (int c = 0; c < 2; c++) {
+        choisir_controle(controles[c]);
+        for (int i = 0; i < NB_ESSAIS; i++) {
+            paquet_aleatoire(TAILLE_INFO_DEFAUT);
+            /* ACK <-> NACK, nouveau numéro : mise à jour incrémentale
+             * égale au calcul complet */
+            modifier_entete(&paquet, i % 2 ? ACK : NACK, rand() % SEQ_NUM_SIZE);
+            uint32_t attendue = generer_controle(&paquet);
+            VERIFIER(paquet.somme_ctrl == attendue,
+                     "modifier_entete (%s) : %08x au lieu de %08x",
+                     c ? "Internet" : "CRC32C", paquet.somme_ctrl, attendue);
+            /* l'erreur reste détectée après la mise à jour (CRC32C) */
+            if (controles[c] == CTRL_CRC32C) {
+                memcpy(&copie, &paquet, offsetof(paquet_t, info) + paquet.lg_info);
+                inverser_bits(&copie, 1 + i % 5);
+                VERIFIER(!verifier_controle(&copie), "erreur non detectee apres modifier_entete");
+            }
+        }
+    }
+}
+
+int main()
+{
+    srand(1); /* essais reproductibles */
+    printf("CRC32C %s\n", crc32c_materiel() ? "materiel (SSE4.2)" : "logiciel (slicing-by-8)");
+    test_valeur_controle();
+    test_implementations();
+    test_erreurs_multibits();
+    test_modifier_entete();
+    printf("%s\n", echecs ? "ECHEC" : "OK");
+    return echecs != 0;
+}
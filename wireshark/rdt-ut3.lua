@@ -18,20 +18,21 @@ local pktTypeNames = {
 	[2] = "ACK",
 	[3] = "NACK",
 	[4] = "CON_REQ",
-	[4] = "CON_ACCEPT",
-	[4] = "CON_REFUSE",
-	[4] = "CON_CLOSE",
-	[4] = "CON_CLOSE_ACK",
+	[5] = "CON_ACCEPT",
+	[6] = "CON_REFUSE",
+	[7] = "CON_CLOSE",
+	[8] = "CON_CLOSE_ACK",
 	[9] = "OTHER"
 }
 
 pktType = ProtoField.uint8("rdt.packet_type", "Packet type", base.DEC, pktTypeNames)
 seqNum = ProtoField.uint8("rdt.seq_num", "Sequence number", base.DEC)
-infoLen = ProtoField.uint8("rdt.info_len", "Information length", base.DEC)
-checksum = ProtoField.uint8("rdt.checksum", "Checksum", base.HEX)
+infoLen = ProtoField.uint16("rdt.info_len", "Information length", base.DEC)
+conId = ProtoField.uint32("rdt.con_id", "Connection ID", base.HEX)
+checksum = ProtoField.uint32("rdt.checksum", "Checksum (CRC32C)", base.HEX)
 payload = ProtoField.string("rdt.payload", "Payload")
 
-rdtProto.fields = {pktType, seqNum, infoLen, checksum, payload}
+rdtProto.fields = {pktType, seqNum, infoLen, conId, checksum, payload}
 
 -- buffer: the packet
 -- pinfo: the columns of the Packet List pane
@@ -57,10 +58,13 @@ function rdtProto.dissector(buffer, pinfo, tree)
   	-- buffer(offset, length)
   	subtree:add_le(pktType,  buffer(0, 1))
   	subtree:add_le(seqNum,   buffer(1, 1))
-  	subtree:add_le(infoLen,  buffer(2, 1))
-  	subtree:add_le(checksum, buffer(3, 1))
-  	local payloadLen = buffer(2, 1):uint()
-	subtree:add(payload, buffer(4, payloadLen))  	
+  	subtree:add_le(infoLen,  buffer(2, 2))
+  	subtree:add_le(conId,    buffer(4, 4))
+  	subtree:add_le(checksum, buffer(8, 4))
+  	local payloadLen = buffer(2, 2):le_uint()
+	if payloadLen > 0 then
+		subtree:add(payload, buffer(12, payloadLen))
+	end
 end
 
 